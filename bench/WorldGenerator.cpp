@@ -0,0 +1,27 @@
+#include "WorldGenerator.h"
+
+static const char *const POLICIES[] = {"nve", "bal", "eco", "env"};
+
+WorldGenerator::WorldGenerator(int settlementCount, int facilityCount, int planCount, unsigned seed)
+    : settlementCount(settlementCount), facilityCount(facilityCount), planCount(planCount), random(seed) {}
+
+//mt19937 output is fixed by the standard, distributions are not, so the range is cut by hand
+int WorldGenerator::pick(int low, int high) {
+    return low + static_cast<int>(random() % static_cast<unsigned>(high - low + 1));
+}
+
+void WorldGenerator::write(std::ostream &out) {
+    for (int i = 0; i < settlementCount; ++i) {
+        out << "settlement S" << i << " " << i % 3 << "\n";
+    }
+    for (int i = 0; i < facilityCount; ++i) {
+        out << "facility F" << i << " " << i % 3 << " " << pick(1, 6) << " "
+            << pick(0, 5) << " " << pick(0, 5) << " " << pick(0, 5) << "\n";
+    }
+    if (settlementCount == 0) {
+        return;
+    }
+    for (int i = 0; i < planCount; ++i) {
+        out << "plan S" << pick(0, settlementCount - 1) << " " << POLICIES[i % 4] << "\n";
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <iostream>
+#include <random>
+
+//Writes a synthetic config: settlements of all three types, facility types of all
+//three categories and plans spread evenly over the four selection policies.
+//The same sizes and seed always give the same world.
+class WorldGenerator {
+    public:
+        WorldGenerator(int settlementCount, int facilityCount, int planCount, unsigned seed);
+        void write(std::ostream &out);
+
+    private:
+        int pick(int low, int high); //uniform in [low, high]
+
+        int settlementCount;
+        int facilityCount;
+        int planCount;
+        std::mt19937 random;
+};
@@ -0,0 +1,277 @@
+#include "Action.h"
+#include "Simulation.h"
+#include "StepEngine.h"
+#include "WorldGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+//normally defined next to main()
+std::unordered_map<string, Simulation*> backups;
+
+//Every allocation in the process goes through here so a benchmark can count its own
+static std::atomic<unsigned long> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+struct Options {
+    int settlements = 100;
+    int facilities = 40;
+    int plans = 2000;
+    int ticks = 200;
+    int repeat = 100;
+    unsigned seed = 1;
+};
+
+//Timings of one benchmark, one entry per operation
+struct Measurement {
+    Measurement() : nanos(), allocations(0) {}
+    vector<double> nanos;
+    unsigned long allocations;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+//Simulation prints as it goes; the output is dropped while a benchmark runs
+class Quiet {
+    public:
+        Quiet() : out(std::cout.rdbuf(nullptr)), err(std::cerr.rdbuf(nullptr)) {}
+        ~Quiet() {
+            std::cout.rdbuf(out);
+            std::cerr.rdbuf(err);
+        }
+        Quiet(const Quiet &other) = delete;
+        Quiet &operator=(const Quiet &other) = delete;
+
+    private:
+        std::streambuf *out;
+        std::streambuf *err;
+};
+
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static double percentile(const vector<double> &sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5)];
+}
+
+//One JSON object per line, so runs can be diffed and loaded by scripts
+static void report(const char *name, const char *op, const Options &options, Measurement &measurement) {
+    vector<double> &nanos = measurement.nanos;
+    std::sort(nanos.begin(), nanos.end());
+    double total = 0;
+    for (double value : nanos) {
+        total += value;
+    }
+    size_t count = nanos.size();
+
+    std::printf("{\"bench\":\"%s\",\"op\":\"%s\",\"settlements\":%d,\"facilities\":%d,\"plans\":%d,"
+                "\"threads\":%u,\"ops\":%zu,\"ops_per_sec\":%.1f,\"p50_us\":%.3f,\"p90_us\":%.3f,"
+                "\"p99_us\":%.3f,\"max_us\":%.3f,\"allocs_per_op\":%.1f,\"peak_rss_kb\":%ld}\n",
+                name, op, options.settlements, options.facilities, options.plans,
+                StepEngine::instance().getThreadCount(), count,
+                total > 0 ? count * 1e9 / total : 0.0,
+                percentile(nanos, 0.50) / 1e3, percentile(nanos, 0.90) / 1e3,
+                percentile(nanos, 0.99) / 1e3, count > 0 ? nanos.back() / 1e3 : 0.0,
+                count > 0 ? static_cast<double>(measurement.allocations) / count : 0.0,
+                peakRssKb());
+    std::fflush(stdout);
+}
+
+static void benchConstruct(const string &world, const Options &options) {
+    Measurement measurement;
+    for (int i = 0; i < options.repeat; ++i) {
+        Quiet quiet;
+        unsigned long before = allocations.load();
+        Clock::time_point start = Clock::now();
+        Simulation *simulation = new Simulation(world);
+        measurement.nanos.push_back(since(start));
+        measurement.allocations += allocations.load() - before;
+        delete simulation;
+    }
+    report("construct", "simulation", options, measurement);
+}
+
+static void benchStep(const string &world, const Options &options) {
+    Measurement measurement;
+    {
+        Quiet quiet;
+        Simulation simulation(world);
+        for (int i = 0; i < options.ticks; ++i) {
+            SimulateStep step(1);
+            unsigned long before = allocations.load();
+            Clock::time_point start = Clock::now();
+            step.act(simulation);
+            measurement.nanos.push_back(since(start));
+            measurement.allocations += allocations.load() - before;
+        }
+    }
+    report("step", "tick", options, measurement);
+}
+
+//Plan::step timed on its own, one sample per plan per tick
+static void benchPlanStep(const string &world, const Options &options) {
+    Measurement measurement;
+    {
+        Quiet quiet;
+        Simulation simulation(world);
+        const FacilityCatalog &facilities = simulation.getFacilitiesOptions();
+        std::ostream log(nullptr);
+        vector<int> ids;
+        for (const auto &plan : simulation.getPlans()) {
+            ids.push_back(plan->getId());
+        }
+        measurement.nanos.reserve(ids.size() * options.ticks);
+
+        for (int i = 0; i < options.ticks; ++i) {
+            for (int id : ids) {
+                Plan &plan = simulation.getPlan(id);
+                unsigned long before = allocations.load();
+                Clock::time_point start = Clock::now();
+                plan.step(facilities, i, log);
+                measurement.nanos.push_back(since(start));
+                measurement.allocations += allocations.load() - before;
+            }
+        }
+    }
+    report("plan_step", "plan", options, measurement);
+}
+
+//Each backup is followed by an untimed tick, so every backup sees changed plans
+static void benchBackup(const string &world, const Options &options) {
+    Measurement measurement;
+    {
+        Quiet quiet;
+        Simulation simulation(world);
+        for (int i = 0; i < options.repeat; ++i) {
+            BackupSimulation backup;
+            unsigned long before = allocations.load();
+            Clock::time_point start = Clock::now();
+            backup.act(simulation);
+            measurement.nanos.push_back(since(start));
+            measurement.allocations += allocations.load() - before;
+
+            SimulateStep step(1);
+            step.act(simulation);
+        }
+    }
+    report("backup", "backup", options, measurement);
+}
+
+static void benchRestore(const string &world, const Options &options) {
+    Measurement measurement;
+    {
+        Quiet quiet;
+        Simulation simulation(world);
+        BackupSimulation backup;
+        backup.act(simulation);
+        for (int i = 0; i < options.repeat; ++i) {
+            SimulateStep step(1);
+            step.act(simulation);
+
+            RestoreSimulation restore;
+            unsigned long before = allocations.load();
+            Clock::time_point start = Clock::now();
+            restore.act(simulation);
+            measurement.nanos.push_back(since(start));
+            measurement.allocations += allocations.load() - before;
+        }
+    }
+    report("restore", "restore", options, measurement);
+}
+
+static bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        int value = std::atoi(argv[i + 1]);
+        if (value < 0) {
+            return false;
+        }
+        if (std::strcmp(argv[i], "--settlements") == 0) options.settlements = value;
+        else if (std::strcmp(argv[i], "--facilities") == 0) options.facilities = value;
+        else if (std::strcmp(argv[i], "--plans") == 0) options.plans = value;
+        else if (std::strcmp(argv[i], "--ticks") == 0) options.ticks = value;
+        else if (std::strcmp(argv[i], "--repeat") == 0) options.repeat = value;
+        else if (std::strcmp(argv[i], "--seed") == 0) options.seed = static_cast<unsigned>(value);
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: bench [--settlements N] [--facilities M] [--plans P] [--ticks T] [--repeat R] [--seed S]" << std::endl;
+        return 1;
+    }
+
+    char world[] = "/tmp/bench_worldXXXXXX";
+    int fd = mkstemp(world);
+    if (fd < 0) {
+        std::cerr << "Error: Can't create the world file" << std::endl;
+        return 1;
+    }
+    close(fd);
+    {
+        std::ofstream out(world);
+        WorldGenerator generator(options.settlements, options.facilities, options.plans, options.seed);
+        generator.write(out);
+    }
+
+    benchConstruct(world, options);
+    benchStep(world, options);
+    benchPlanStep(world, options);
+    benchBackup(world, options);
+    benchRestore(world, options);
+
+    for (auto &snapshot : backups) {
+        delete snapshot.second;
+    }
+    backups.clear();
+    unlink(world);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#include "WorldGenerator.h"
+#include <cstdlib>
+#include <iostream>
+
+//usage: generate_world <settlements> <facilities> <plans> [seed] > config.txt
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 5) {
+        std::cerr << "usage: generate_world <settlements> <facilities> <plans> [seed]" << std::endl;
+        return 1;
+    }
+    unsigned seed = argc == 5 ? static_cast<unsigned>(std::atoi(argv[4])) : 1;
+    WorldGenerator generator(std::atoi(argv[1]), std::atoi(argv[2]), std::atoi(argv[3]), seed);
+    generator.write(std::cout);
+    return 0;
+}
@@ -9,6 +9,15 @@ enum class ActionStatus{
     COMPLETED, ERROR
 };
 
+//identifies an action in checkpoint files and action log records
+enum class ActionType{
+    SIMULATE_STEP, ADD_PLAN, ADD_SETTLEMENT, ADD_FACILITY, PRINT_PLAN_STATUS, CHANGE_PLAN_POLICY,
+    PRINT_ACTIONS_LOG, CLOSE, BACKUP, RESTORE, SAVE, LOAD, REPLAY, STATS, TOP_PLANS, PRINT_WORLD_SCORES
+};
+
+class ValueWriter;
+class ValueReader;
+
 class BaseAction{
     public:
         BaseAction();
@@ -17,8 +26,12 @@ class BaseAction{
         virtual const string toString() const=0;
         virtual BaseAction* clone() const = 0;
         virtual ~BaseAction() = default;
+        virtual ActionType getType() const = 0;
+        void save(ValueWriter &writer) const;
+        static BaseAction *load(ValueReader &reader);
 
     protected:
+        virtual void saveArguments(ValueWriter &writer) const = 0;
         void complete();
         void error(string errorMsg);
         const string &getErrorMsg() const;
@@ -35,7 +48,10 @@ class SimulateStep : public BaseAction {
         void act(Simulation &simulation) override;
         const string toString() const override;
         SimulateStep *clone() const override;
+        ActionType getType() const override;
+        int getNumOfSteps() const;
     private:
+        void saveArguments(ValueWriter &writer) const override;
         const int numOfSteps;
 };
 
@@ -45,7 +61,9 @@ class AddPlan : public BaseAction {
         void act(Simulation &simulation) override;
         const string toString() const override;
         AddPlan *clone() const override;
+        ActionType getType() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
         const string settlementName;
         const string selectionPolicy;
 };
@@ -56,8 +74,10 @@ class AddSettlement : public BaseAction {
         AddSettlement(const string &settlementName,SettlementType settlementType);
         void act(Simulation &simulation) override;
         AddSettlement *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
         const string settlementName;
         const SettlementType settlementType;
 };
@@ -69,8 +89,10 @@ class AddFacility : public BaseAction {
         AddFacility(const string &facilityName, const FacilityCategory facilityCategory, const int price, const int lifeQualityScore, const int economyScore, const int environmentScore);
         void act(Simulation &simulation) override;
         AddFacility *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
         const string facilityName;
         const FacilityCategory facilityCategory;
         const int price;
@@ -85,8 +107,10 @@ class PrintPlanStatus: public BaseAction {
         PrintPlanStatus(int planId);
         void act(Simulation &simulation) override;
         PrintPlanStatus *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
         const int planId;
 };
 
@@ -96,8 +120,10 @@ class ChangePlanPolicy : public BaseAction {
         ChangePlanPolicy(const int planId, const string &newPolicy);
         void act(Simulation &simulation) override;
         ChangePlanPolicy *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
         const int planId;
         const string newPolicy;
 };
@@ -108,8 +134,10 @@ class PrintActionsLog : public BaseAction {
         PrintActionsLog();
         void act(Simulation &simulation) override;
         PrintActionsLog *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
 };
 
 class Close : public BaseAction {
@@ -117,25 +145,106 @@ class Close : public BaseAction {
         Close();
         void act(Simulation &simulation) override;
         Close *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
 };
 
 class BackupSimulation : public BaseAction {
     public:
         BackupSimulation();
+        BackupSimulation(const string &name);
         void act(Simulation &simulation) override;
         BackupSimulation *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
+        const string name;
 };
 
 
 class RestoreSimulation : public BaseAction {
     public:
         RestoreSimulation();
+        RestoreSimulation(const string &name);
         void act(Simulation &simulation) override;
         RestoreSimulation *clone() const override;
+        ActionType getType() const override;
+        const string toString() const override;
+    private:
+        void saveArguments(ValueWriter &writer) const override;
+        const string name;
+};
+
+class SaveSimulation : public BaseAction {
+    public:
+        SaveSimulation(const string &path);
+        void act(Simulation &simulation) override;
+        SaveSimulation *clone() const override;
+        ActionType getType() const override;
+        const string toString() const override;
+    private:
+        void saveArguments(ValueWriter &writer) const override;
+        const string path;
+};
+
+class LoadSimulation : public BaseAction {
+    public:
+        LoadSimulation(const string &path);
+        void act(Simulation &simulation) override;
+        LoadSimulation *clone() const override;
+        ActionType getType() const override;
+        const string toString() const override;
+    private:
+        void saveArguments(ValueWriter &writer) const override;
+        const string path;
+};
+
+class ReplayJournal : public BaseAction {
+    public:
+        ReplayJournal(const string &path);
+        void act(Simulation &simulation) override;
+        ReplayJournal *clone() const override;
+        ActionType getType() const override;
+        const string toString() const override;
+    private:
+        void saveArguments(ValueWriter &writer) const override;
+        const string path;
+};
+
+class PrintStats : public BaseAction {
+    public:
+        PrintStats();
+        void act(Simulation &simulation) override;
+        PrintStats *clone() const override;
+        ActionType getType() const override;
+        const string toString() const override;
+    private:
+        void saveArguments(ValueWriter &writer) const override;
+};
+
+class TopPlans : public BaseAction {
+    public:
+        TopPlans(const string &metric, int count);
+        void act(Simulation &simulation) override;
+        TopPlans *clone() const override;
+        ActionType getType() const override;
+        const string toString() const override;
+    private:
+        void saveArguments(ValueWriter &writer) const override;
+        const string metric;
+        const int count;
+};
+
+class PrintWorldScores : public BaseAction {
+    public:
+        PrintWorldScores();
+        void act(Simulation &simulation) override;
+        PrintWorldScores *clone() const override;
+        ActionType getType() const override;
         const string toString() const override;
     private:
+        void saveArguments(ValueWriter &writer) const override;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Checkpoint.h"
+#include "SymbolTable.h"
+using std::string;
+using std::vector;
+
+class BaseAction;
+
+//type, status, message and up to six arguments (AddFacility needs them all)
+const int ACTION_RECORD_FIELDS = 9;
+
+//An action as it sits in the log: its stored values in order, strings replaced by pool ids
+struct ActionRecord {
+    uint16_t count;
+    uint16_t stringMask;    //bit i set when fields[i] is a string id
+    int32_t fields[ACTION_RECORD_FIELDS];
+};
+
+//Numbers every string the log has seen, so a record can hold it in 32 bits. The text itself
+//lives in the symbol table. Ids never change, so snapshots can share one pool.
+class StringPool {
+    public:
+        explicit StringPool(const std::shared_ptr<SymbolTable> &symbols);
+        int intern(const string &value);
+        const string &get(int id) const;
+        size_t size() const;
+
+    private:
+        std::shared_ptr<SymbolTable> symbols;
+        std::unordered_map<Symbol, int, SymbolHash> ids;
+        vector<Symbol> strings;
+};
+
+//Spilled chunks of records, appended to a file for the rest of the run
+class ActionJournal {
+    public:
+        explicit ActionJournal(const string &path);
+        ~ActionJournal();
+        ActionJournal(const ActionJournal &other) = delete;
+        ActionJournal &operator=(const ActionJournal &other) = delete;
+
+        int64_t append(const ActionRecord *records, size_t count);
+        void read(int64_t offset, ActionRecord *records, size_t count) const;
+
+    private:
+        int fd;
+        int64_t end;
+};
+
+//The executed actions, as fixed-size records in chunks. Full chunks never change, so a
+//copy of the log shares them and only the partly filled last chunk is copied on append.
+//With a limit, only the newest records stay in memory; older chunks go to the journal
+//if there is one and are dropped otherwise.
+class ActionLog {
+    public:
+        ActionLog();
+        explicit ActionLog(const std::shared_ptr<SymbolTable> &symbols); //strings are interned there
+        //limit 0 keeps every record in memory; an empty path means no journal
+        void configure(size_t limit, const string &journalPath);
+        ActionLog cleared() const;  //same settings and string pool, no records
+
+        void append(const BaseAction &action);
+        size_t size() const;    //records that can still be listed
+        //visits the records oldest first, rebuilding each action in turn
+        void forEach(const std::function<void(const BaseAction &)> &visit) const;
+        void save(CheckpointWriter &writer) const;
+        void load(CheckpointReader &reader);    //appends the checkpoint's actions
+
+    private:
+        static const size_t CHUNK_RECORDS = 1024;
+        typedef vector<ActionRecord> Chunk;
+
+        void trim();
+        size_t firstListed() const;
+        void forEachRecord(const std::function<void(const ActionRecord &)> &visit) const;
+
+        std::deque<std::shared_ptr<Chunk>> chunks;
+        size_t dropped;     //chunks removed from the front of memory
+        size_t count;       //records appended so far
+        size_t limit;
+        vector<int64_t> spilled;    //journal offset of each spilled chunk, oldest first
+        std::shared_ptr<StringPool> strings;
+        std::shared_ptr<ActionJournal> journal;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <streambuf>
+#include <vector>
+using std::vector;
+
+//Stream buffers for batch mode. Input is read from a file descriptor in large blocks;
+//output is collected in a large buffer and written out only when it fills up or the
+//stream is flushed (std::cerr is tied to std::cout, so errors still come out in order).
+class BlockInputBuffer : public std::streambuf {
+    public:
+        BlockInputBuffer(int fd, size_t size);
+        BlockInputBuffer(const BlockInputBuffer &other) = delete;
+        BlockInputBuffer &operator=(const BlockInputBuffer &other) = delete;
+
+    protected:
+        int_type underflow() override;
+
+    private:
+        int fd;
+        vector<char> buffer;
+};
+
+class BlockOutputBuffer : public std::streambuf {
+    public:
+        BlockOutputBuffer(int fd, size_t size);
+        ~BlockOutputBuffer() override;
+        BlockOutputBuffer(const BlockOutputBuffer &other) = delete;
+        BlockOutputBuffer &operator=(const BlockOutputBuffer &other) = delete;
+
+    protected:
+        int_type overflow(int_type c) override;
+        int sync() override;
+
+    private:
+        bool writeOut();
+
+        int fd;
+        vector<char> buffer;
+};
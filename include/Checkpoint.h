@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using std::string;
+
+//Checkpoint files start with this magic and a format version.
+//Integers are stored as 4 little-endian bytes, strings as a length followed by the bytes.
+extern const char CHECKPOINT_MAGIC[8];
+const int CHECKPOINT_VERSION = 2;
+
+//Where actions store their arguments: checkpoints, and the records of the action log
+class ValueWriter {
+    public:
+        virtual ~ValueWriter() = default;
+        virtual void writeInt(int value) = 0;
+        virtual void writeString(const string &value) = 0;
+};
+
+class ValueReader {
+    public:
+        virtual ~ValueReader() = default;
+        virtual int readInt() = 0;
+        virtual string readString() = 0;
+};
+
+//Collects a checkpoint in memory and writes it out in one go
+class CheckpointWriter : public ValueWriter {
+    public:
+        CheckpointWriter();
+        void writeInt(int value) override;
+        void writeString(const string &value) override;
+        void saveTo(const string &path) const;
+
+    private:
+        string buffer;
+};
+
+//Reads a checkpoint through mmap. Throws std::runtime_error on a bad header or a truncated file.
+class CheckpointReader : public ValueReader {
+    public:
+        explicit CheckpointReader(const string &path);
+        ~CheckpointReader() override;
+        CheckpointReader(const CheckpointReader &other) = delete;
+        CheckpointReader &operator=(const CheckpointReader &other) = delete;
+
+        int readInt() override;
+        string readString() override;
+        bool atEnd() const;
+
+    private:
+        void need(size_t bytes) const;
+        void release();
+
+        int fd;
+        const unsigned char *data;
+        size_t size;
+        size_t offset;
+};
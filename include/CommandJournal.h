@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "Checkpoint.h"
+using std::string;
+
+class BaseAction;
+enum class ActionType;
+
+//Journal files start with this magic and a format version, then hold one record per
+//completed state-changing action: the action's length in bytes, an FNV-1a checksum of it,
+//and the action in the layout of BaseAction::save
+extern const char JOURNAL_MAGIC[8];
+const int JOURNAL_VERSION = 2;
+
+//Appends actions to a journal as they complete. Each record goes out in a single write(),
+//so a crash loses at most the record being written. Opening an existing journal cuts it
+//back to its last whole record, so a record a crash broke off is never followed by new ones.
+class CommandJournal : public ValueWriter {
+    public:
+        explicit CommandJournal(const string &path);  //appends to an existing journal
+        ~CommandJournal() override;
+        CommandJournal(const CommandJournal &other) = delete;
+        CommandJournal &operator=(const CommandJournal &other) = delete;
+
+        static bool isJournaled(ActionType type);
+        void record(const BaseAction &action);
+        bool isSameFile(const string &path) const;
+        void setSuspended(bool suspended);  //replaying a journal into itself must not extend it
+        size_t getCutBytes() const;          //damaged bytes removed from the end on opening
+
+        void writeInt(int value) override;
+        void writeString(const string &value) override;
+
+    private:
+        void flush();
+
+        int fd;
+        bool suspended;
+        string buffer;
+        size_t cutBytes;
+};
+
+//Reads a whole journal into memory. Throws std::runtime_error on a bad header, and on a
+//record that is cut short, fails its checksum or holds more or less than one action.
+class JournalReader : public ValueReader {
+    public:
+        explicit JournalReader(const string &path);
+
+        void beginRecord();         //the reads that follow stay inside the next record
+        void endRecord();           //checks the action used up the whole record
+        int readInt() override;
+        string readString() override;
+        bool atEnd() const;
+        size_t getOffset() const;   //bytes from the start of the file
+
+    private:
+        void need(size_t bytes) const;
+
+        string data;
+        size_t offset;
+        size_t recordEnd;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+//A word of the config file, pointing straight into the mapped file (nothing is copied)
+struct ConfigToken {
+    const char *begin;
+    size_t length;
+
+    bool operator==(const char *word) const;
+    bool operator!=(const char *word) const;
+    string str() const;
+    bool toInt(int &value) const;
+};
+
+//Reads a config file through mmap and splits it into lines of tokens.
+//Only entity names are ever copied out of the mapping.
+class ConfigLoader {
+    public:
+        explicit ConfigLoader(const string &configFilePath);
+        ~ConfigLoader();
+        ConfigLoader(const ConfigLoader &other) = delete;
+        ConfigLoader &operator=(const ConfigLoader &other) = delete;
+
+        bool isOpen() const;
+        bool nextLine(vector<ConfigToken> &tokens);
+        size_t getLineNumber() const;
+        string getLine() const;
+        void countRecords(size_t &settlements, size_t &facilities, size_t &plans) const;
+
+    private:
+        int fd;
+        const char *data;
+        size_t size;
+        const char *cursor;
+        const char *lineBegin;
+        const char *lineEnd;
+        size_t lineNumber;
+};
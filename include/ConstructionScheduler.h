@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+using std::vector;
+
+//Decides which plans a tick has to step. A plan with a free construction slot is due on
+//every tick (it picks a facility, or reports why it cannot); a plan with every slot busy
+//has nothing to do until its first construction finishes, so it sleeps until that tick.
+//Plans are named by their slot in the simulation's plan vector, and the plans due on a
+//tick are handed out in that order, so diagnostics keep coming out in plan order.
+//
+//Near ticks sit in a timing wheel, one bucket per tick, each a bitset over the plan slots,
+//so adding a plan is O(1) and a bucket reads out in slot order without sorting. The rare
+//plan sleeping past the wheel's end waits in a heap.
+class ConstructionScheduler {
+    public:
+        ConstructionScheduler();
+
+        void clear(int64_t tick);           //empties it; nothing will be due before tick
+        void add(size_t slot, int64_t tick); //due on tick
+        int64_t nextTick() const;   //earliest tick any plan is due on, INT64_MAX if none
+        void takeDue(int64_t tick, vector<size_t> &due); //removes the plans due on tick, in slot order
+
+    private:
+        static const int64_t WHEEL_TICKS = 64;
+        typedef std::pair<int64_t, size_t> Entry; //tick, slot
+
+        vector<vector<uint64_t>> wheel; //bucket tick % WHEEL_TICKS, for ticks in [base, base + WHEEL_TICKS)
+        vector<size_t> counts;          //plans in each bucket
+        size_t words;                   //64-slot words in each bucket
+        int64_t base;
+        size_t wheeled;                 //plans in the wheel
+        std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> later;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Metrics.h"
+#include "ObjectPool.h"
+
+//Heap bytes owned by a value, for counting what copy-on-write copies. Types with their own
+//overload are found through argument-dependent lookup (Plan has one).
+template <typename T>
+size_t heapBytes(const T &) { return 0; }
+
+template <typename T>
+size_t heapBytes(const std::vector<T> &values) { return values.capacity() * sizeof(T); }
+
+template <typename K, typename V, typename H>
+size_t heapBytes(const std::unordered_map<K, V, H> &values) {
+    return values.size() * (sizeof(std::pair<const K, V>) + 2 * sizeof(void *)) + values.bucket_count() * sizeof(void *);
+}
+
+//Shared, copy-on-write ownership of a value. Copying a CowPtr only shares the value;
+//the first write() through a shared CowPtr gives it a private copy first.
+//Simulation snapshots are built from these, so a backup copies no data until one side changes.
+template <typename T>
+class CowPtr {
+    public:
+        //values and their control blocks come from the object pool
+        CowPtr() : value(std::allocate_shared<T>(PoolAllocator<T>())) {}
+        explicit CowPtr(T *value) : value(value, std::default_delete<T>(), PoolAllocator<T>()) {}
+
+        const T &operator*() const { return *value; }
+        const T *operator->() const { return value.get(); }
+        const T &read() const { return *value; }
+
+        T &write() {
+            if (value.use_count() > 1) {
+                value = std::allocate_shared<T>(PoolAllocator<T>(), *value);
+                METRIC_ADD(Counter::SHARED_BYTES_COPIED, sizeof(T) + heapBytes(*value));
+            }
+            return *value;
+        }
+
+        bool isShared() const { return value.use_count() > 1; }
+
+    private:
+        std::shared_ptr<T> value;
+};
@@ -1,9 +1,15 @@
 #pragma once
+#include <iosfwd>
 #include <string>
 #include <vector>
+#include "SymbolTable.h"
 using std::string;
 using std::vector;
 
+class CheckpointWriter;
+class CheckpointReader;
+class SymbolTable;
+
 enum class FacilityStatus {
     UNDER_CONSTRUCTIONS,
     OPERATIONAL,
@@ -18,7 +24,7 @@ enum class FacilityCategory {
 
 class FacilityType {
     public:
-        FacilityType(const string &name, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
+        FacilityType(Symbol name, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
         FacilityType(const FacilityType &) = default;
         FacilityType(FacilityType &&) noexcept = default;
         FacilityType &operator=(const FacilityType &) = delete;
@@ -27,14 +33,17 @@ class FacilityType {
         FacilityType *clone() const;
         bool operator==(const FacilityType& other) const;
         const string &getName() const;
+        Symbol getSymbol() const;
         int getCost() const;
         int getLifeQualityScore() const;
         int getEnvironmentScore() const;
         int getEconomyScore() const;
         FacilityCategory getCategory() const;
+        void save(CheckpointWriter &writer) const;
+        static FacilityType load(CheckpointReader &reader, SymbolTable &symbols);
 
     protected:
-        const string name;
+        const Symbol name;
         const FacilityCategory category;
         const int price;
         const int lifeQuality_score;
@@ -47,18 +56,21 @@ class FacilityType {
 class Facility: public FacilityType {
 
     public:
-        Facility(const string &name, const string &settlementName, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
-        Facility(const FacilityType &type, const string &settlementName);
+        Facility(Symbol name, Symbol settlementName, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
+        Facility(const FacilityType &type, Symbol settlementName);
+        Facility(const FacilityType &type, Symbol settlementName, FacilityStatus status, int timeLeft);
         const string &getSettlementName() const;
         int getTimeLeft() const;
         FacilityStatus step();
         void setStatus(FacilityStatus status);
         const FacilityStatus& getStatus() const;
         const string toString() const;
+        //the toString line for a facility that is only stored as its type, status and time left
+        static void describe(std::ostream &out, const string &name, const string &settlementName, FacilityStatus status, int timeLeft);
         void ReduceTimeLeft();
 
     private:
-        const string settlementName;
+        const Symbol settlementName;
         FacilityStatus status;
         int timeLeft;
 };
\ No newline at end of file
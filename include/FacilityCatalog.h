@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include "Facility.h"
+using std::vector;
+
+//The facility options of a simulation. Alongside the FacilityType list it keeps each
+//impact score in its own packed int array, so selection kernels can read many
+//candidates at once without touching the FacilityType objects, and indexes the
+//facilities by category for the round-robin policies.
+class FacilityCatalog {
+    public:
+        FacilityCatalog();
+
+        void reserve(size_t count);
+        void add(const FacilityType &facility);
+        size_t size() const;
+        bool empty() const;
+        const FacilityType &operator[](size_t index) const;
+        int indexOf(const FacilityType &facility) const;
+        const vector<FacilityType> &getFacilities() const;
+        //index of the facility that leaves the three scores closest to each other
+        //(smallest sum of max - score), the first one on ties; -1 if there is none
+        int findMostBalanced(int lifeQualityScore, int economyScore, int environmentScore) const;
+        //first facility of the category at or after the given position, wrapping around; -1 if there is none
+        int nextInCategory(FacilityCategory category, size_t from) const;
+        bool hasCategory(FacilityCategory category) const;
+
+        const int *getLifeQualityScores() const;
+        const int *getEconomyScores() const;
+        const int *getEnvironmentScores() const;
+
+    private:
+        vector<FacilityType> facilities;
+        vector<int> lifeQualityScores;
+        vector<int> economyScores;
+        vector<int> environmentScores;
+        //per category, for every position the index of the next facility of that category,
+        //or -1 past the last one; kept up to date by add
+        vector<vector<int>> nextByCategory;
+};
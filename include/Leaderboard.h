@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CowPtr.h"
+#include "ObjectPool.h"
+#include "Plan.h"
+using std::string;
+using std::vector;
+
+//what plans can be ranked by; TOTAL is the three scores added up
+enum class ScoreMetric {
+    LIFE_QUALITY, ECONOMY, ENVIRONMENT, TOTAL
+};
+const int SCORE_METRICS = 4;
+
+//Every plan's scores, ranked per metric and summed over the world. Stepping a plan only
+//marks its slot; the marked plans are re-ranked when the leaderboard is next read, so a
+//plan costs O(log n) per metric once per read however many facilities it completed.
+class Leaderboard {
+    public:
+        Leaderboard();
+        void clear();
+        void update(size_t slot, const Plan &plan); //ranks the plan in this slot of the simulation now
+        void touch(size_t slot);                    //the plan in this slot may have changed
+        void refresh(const vector<CowPtr<Plan>> &plans); //re-ranks the touched plans
+
+        size_t size() const;
+        int64_t getTotal(ScoreMetric metric) const;
+        //the k best plans by the metric as (plan id, score), best first; ties go to the lower plan id
+        vector<std::pair<int, int64_t>> top(ScoreMetric metric, size_t k) const;
+
+        static bool parseMetric(const string &name, ScoreMetric &metric); //life, economy, environment, total
+        static const char *metricName(ScoreMetric metric);
+
+    private:
+        typedef std::pair<int64_t, int> Entry; //negated score, plan id: the set's order is best first
+        struct Scores {
+            int planId;
+            int64_t values[SCORE_METRICS];
+        };
+
+        std::set<Entry, std::less<Entry>, PoolAllocator<Entry>> rankings[SCORE_METRICS];
+        vector<Scores> scores;  //by slot, as last ranked
+        vector<bool> ranked;    //by slot
+        vector<bool> touched;   //by slot
+        vector<size_t> pending; //touched slots
+        size_t count;
+        int64_t totals[SCORE_METRICS];
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+using std::string;
+
+//Counters and timers on the hot paths, read by the `stats` command and the periodic dump.
+//Updates are relaxed atomic adds, so plans stepped on worker threads can count too.
+//Building with -DSIM_NO_METRICS (release and pgo do) turns every METRIC_ macro into nothing.
+enum class Counter {
+    TICKS, STEPS, PLAN_STEPS, FACILITIES_STARTED, FACILITIES_COMPLETED, BACKUPS, RESTORES,
+    SHARED_BYTES_COPIED, COUNT
+};
+
+enum class Timer {
+    SIMULATION_STEP, PLAN_STEPS, SELECT_NAIVE, SELECT_BALANCED, SELECT_ECONOMY, SELECT_SUSTAINABILITY,
+    CONSTRUCT, BACKUP, RESTORE, COUNT
+};
+
+const int COUNTER_COUNT = static_cast<int>(Counter::COUNT);
+const int TIMER_COUNT = static_cast<int>(Timer::COUNT);
+
+class Metrics {
+    public:
+        static Metrics &instance();
+        Metrics(const Metrics &other) = delete;
+        Metrics &operator=(const Metrics &other) = delete;
+
+        void add(Counter counter, uint64_t amount) {
+            if (amount == 0) {
+                return; //most plan steps start and complete nothing
+            }
+            counters[static_cast<int>(counter)].fetch_add(amount, std::memory_order_relaxed);
+        }
+        void record(Timer timer, uint64_t nanos) {
+            timerCounts[static_cast<int>(timer)].fetch_add(1, std::memory_order_relaxed);
+            timerNanos[static_cast<int>(timer)].fetch_add(nanos, std::memory_order_relaxed);
+        }
+
+        //operator new runs before and while the instance is built, so it counts into a plain static
+        static void countAllocation() {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //called at the end of Simulation::step: keeps that step's deltas and writes the dump when due
+        void endStep();
+        //one "name value" line per metric
+        void print(std::ostream &out) const;
+        //true for a printed metric that counts work on plans, so shards holding different plans
+        //can add theirs up; the others (ticks, steps, backups...) are the same for the whole world
+        static bool isPerPlan(const string &name);
+
+    private:
+        Metrics();
+
+        static std::atomic<uint64_t> allocations;
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        std::atomic<uint64_t> timerCounts[TIMER_COUNT];
+        std::atomic<uint64_t> timerNanos[TIMER_COUNT];
+        uint64_t previous[COUNTER_COUNT];   //counters at the end of the step before the last one
+        uint64_t lastStep[COUNTER_COUNT];   //what the last step added
+        string dumpPath;                    //SIM_METRICS_FILE, empty for no dump
+        uint64_t dumpEvery;                 //SIM_METRICS_EVERY ticks
+        uint64_t nextDump;
+};
+
+//Adds the time until the end of the scope to a timer
+class ScopedTimer {
+    public:
+        explicit ScopedTimer(Timer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+            Metrics::instance().record(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        ScopedTimer(const ScopedTimer &other) = delete;
+        ScopedTimer &operator=(const ScopedTimer &other) = delete;
+
+    private:
+        Timer timer;
+        std::chrono::steady_clock::time_point start;
+};
+
+#define METRIC_JOIN_(a, b) a##b
+#define METRIC_JOIN(a, b) METRIC_JOIN_(a, b)
+
+#ifdef SIM_NO_METRICS
+#define METRIC_ADD(counter, amount) ((void)0)
+#define METRIC_TIME(timer) ((void)0)
+#define METRIC_ONLY(code)
+#else
+#define METRIC_ADD(counter, amount) Metrics::instance().add(counter, amount)
+#define METRIC_TIME(timer) ScopedTimer METRIC_JOIN(metricTimer, __LINE__)(timer)
+#define METRIC_ONLY(code) code
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+using std::vector;
+
+//Fixed-size blocks for the small objects a simulation makes and drops by the hundred
+//thousand: plans and their shared_ptr control blocks, selection policies and settlements.
+//A block is a free-list pop or a pointer bump into a 64KB chunk, and freeing one pushes it
+//back on its size class's list. Chunks are never handed back one by one; they are all
+//released together when the pool is destroyed at exit.
+class ObjectPool {
+    public:
+        static ObjectPool &instance();
+        ~ObjectPool();
+        ObjectPool(const ObjectPool &other) = delete;
+        ObjectPool &operator=(const ObjectPool &other) = delete;
+
+        void *allocate(size_t size);
+        void deallocate(void *memory, size_t size);
+
+    private:
+        ObjectPool();
+        void *refill(size_t sizeClass);
+
+        static const size_t GRANULE = 16;
+        static const size_t MAX_BLOCK = 512;    //larger requests go to operator new
+        static const size_t CLASS_COUNT = MAX_BLOCK / GRANULE;
+        static const size_t CHUNK_SIZE = 64 * 1024;
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        FreeBlock *freeLists[CLASS_COUNT];
+        char *cursor;   //unused tail of the newest chunk
+        char *limit;
+        vector<void *> chunks;
+        std::atomic_flag busy;  //pooled objects are made on the main thread; this only keeps it honest
+};
+
+//Lets std::allocate_shared put a shared_ptr's object and control block in the pool
+template <typename T>
+class PoolAllocator {
+    public:
+        typedef T value_type;
+
+        PoolAllocator() {}
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &) {}
+
+        T *allocate(size_t count) {
+            return static_cast<T *>(ObjectPool::instance().allocate(count * sizeof(T)));
+        }
+        void deallocate(T *memory, size_t count) {
+            ObjectPool::instance().deallocate(memory, count * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
+
+//Class-level operator new and delete that draw from the pool
+#define POOLED_OBJECT \
+    static void *operator new(size_t size) { return ObjectPool::instance().allocate(size); } \
+    static void operator delete(void *memory, size_t size) { ObjectPool::instance().deallocate(memory, size); }
@@ -1,10 +1,17 @@
 #pragma once
+#include <cstdint>
+#include <iostream>
+#include <map>
 #include <vector>
 #include "Facility.h"
+#include "ObjectPool.h"
 #include "Settlement.h"
 #include "SelectionPolicy.h"
 using std::vector;
 
+//Below this many ticks, looking for a plan's cycle costs more than ticking
+const int MIN_FAST_FORWARD_TICKS = 16;
+
 enum class PlanStatus {
     AVALIABLE,
     BUSY,
@@ -12,34 +19,65 @@ enum class PlanStatus {
 
 class Plan {
     public:
-        Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions);
+        Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy);
         ~Plan();                                     
         Plan(const Plan &other);                     
         Plan &operator=(const Plan &other) = delete;          
         Plan(Plan &&other) noexcept;                 
         Plan &operator=(Plan &&other) noexcept = delete;      
+        POOLED_OBJECT
 
         int getlifeQualityScore() const;
         int getEconomyScore() const;
         int getEnvironmentScore() const;
         void setSelectionPolicy(SelectionPolicy *selectionPolicy);
-        void step();
+        //ticks are numbered by the simulation; a step runs tick "now"
+        void step(const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log);
+        //step for plans that all have this policy kind and settlement type
+        static void stepGroup(Plan *const *plans, size_t count, PolicyKind kind,
+                              const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log);
+        void advance(const FacilityCatalog &facilityOptions, int64_t now, int ticks, std::ostream &log);
+        bool isPeriodic(const FacilityCatalog &facilityOptions) const;
+        int64_t getNextTick() const; //first tick the plan has a free slot or a completion on
+        const SelectionPolicy &getSelectionPolicy() const;
+        PlanStatus getStatus() const;
         void printStatus();
-        const vector<Facility*> &getFacilities() const;
-        void addFacility(Facility* facility);
-        const string toString() const;
+        const vector<int> &getFacilities() const;
+        const vector<int> &getUnderConstruction() const;
+        //"now" is the next tick to run, time left is counted from it
+        const string toString(const FacilityCatalog &facilityOptions, int64_t now) const;
+        void print(std::ostream &out, const FacilityCatalog &facilityOptions, int64_t now) const; //toString, streamed
         int getConstructionLimit(const Settlement& settlement);
         bool isSamePolicy(const SelectionPolicy *policy) const;
         int getId() const;
         const string resultPrint() const;
+        const Settlement &getSettlement() const;
+        void save(CheckpointWriter &writer, int64_t now) const;
+        static Plan *load(CheckpointReader &reader, const Settlement &settlement, const FacilityCatalog &facilityOptions, int64_t now);
+        size_t getHeapBytes() const; //construction and facility storage, for the copy metrics
 
     private:
+        vector<int> cycleKey(int64_t now) const;
+        template <typename Policy>
+        static void stepGroup(Plan *const *plans, size_t count, const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log, size_t constructionLimit);
+        template <typename Policy>
+        void stepAs(const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log, size_t constructionLimit);
+        template <typename Policy>
+        void fillSlots(Policy &policy, const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log, size_t constructionLimit);
+
         int plan_id;
         const Settlement &settlement;
         SelectionPolicy *selectionPolicy; //What happens if we change this to a reference?
         PlanStatus status;
-        vector<Facility*> facilities;
-        vector<Facility*> underConstruction;
-        const vector<FacilityType> &facilityOptions;
+        //facilities are stored as indices into the simulation's facility options, which are
+        //passed in by the caller; Facility objects are only built for printing
+        vector<int> facilities;                 //operational, in completion order
+        vector<int> underConstruction;          //facility type of each construction slot
+        vector<int64_t> underConstructionFinish; //tick each construction slot completes on
+        int64_t nextTick;                       //set by step; see getNextTick
         int life_quality_score, economy_score, environment_score;
-};
\ No newline at end of file
+};
+
+inline size_t heapBytes(const Plan &plan) {
+    return plan.getHeapBytes();
+}
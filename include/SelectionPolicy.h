@@ -1,42 +1,76 @@
 #pragma once
 #include <vector>
-#include "Facility.h"
+#include "FacilityCatalog.h"
+#include "ObjectPool.h"
 using std::vector;
 
+//Which concrete policy an object is. Plan::step switches on it once per step and then calls
+//the (final) policy class directly, so the fill loop needs no virtual call or RTTI.
+enum class PolicyKind {
+    NAIVE, BALANCED, ECONOMY, SUSTAINABILITY
+};
+const size_t POLICY_KINDS = 4;
+
 class SelectionPolicy {
     public:
-        SelectionPolicy() : selectedFacility() {}
-        virtual const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) = 0;
+        explicit SelectionPolicy(PolicyKind kind) : kind(kind), selectedCount() {}
+        POOLED_OBJECT
+        PolicyKind getKind() const { return kind; }
+        virtual const FacilityType& selectFacility(const FacilityCatalog &facilitiesOptions) = 0;
         virtual const string toString() const = 0;
         virtual SelectionPolicy* clone() const = 0;
         virtual ~SelectionPolicy() = default;
+        //position in a fixed selection cycle, or -1 when picks depend on what was built before
+        virtual int getCyclePosition() const = 0;
+        virtual bool canSelect(const FacilityCatalog &facilitiesOptions) const = 0;
+        //what a failed pick reports when canSelect is false
+        virtual const string unavailableMessage() const = 0;
 
-        bool isFacilitySelected(const FacilityType& facility);
-        void markFacilityAsSelected(const FacilityType& facility);
+        bool isFacilitySelected(int facilityIndex) const;
+        void markFacilityAsSelected(int facilityIndex);
+        void save(CheckpointWriter &writer) const;
+        static SelectionPolicy *load(CheckpointReader &reader, const FacilityCatalog &facilitiesOptions);
 
     protected:
-        vector<FacilityType> selectedFacility;
+        //policy specific part of a checkpoint
+        virtual void saveState(CheckpointWriter &writer) const = 0;
+        virtual void loadState(CheckpointReader &reader) = 0;
+
+        const PolicyKind kind;
+        vector<int> selectedCount; //times each facility option was picked, by index
 };
 
-class NaiveSelection: public SelectionPolicy {
+class NaiveSelection final : public SelectionPolicy {
     public:
         NaiveSelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog &facilitiesOptions) override;
         const string toString() const override;
         NaiveSelection *clone() const override;
+        int getCyclePosition() const override;
+        bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
+        const string unavailableMessage() const override;
         ~NaiveSelection() override = default;
+    protected:
+        void saveState(CheckpointWriter &writer) const override;
+        void loadState(CheckpointReader &reader) override;
     private:
         int lastSelectedIndex;
 };
 
-class BalancedSelection: public SelectionPolicy {
+class BalancedSelection final : public SelectionPolicy {
     public:
         BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore);
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog &facilitiesOptions) override;
         const string toString() const override;
         BalancedSelection *clone() const override;
+        int getCyclePosition() const override;
+        bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
+        const string unavailableMessage() const override;
         ~BalancedSelection() override = default;
         void updateScore(const FacilityType& facility);
+    protected:
+        void saveState(CheckpointWriter &writer) const override;
+        void loadState(CheckpointReader &reader) override;
 
     private:
         int LifeQualityScore;
@@ -44,25 +78,37 @@ class BalancedSelection: public SelectionPolicy {
         int EnvironmentScore;
 };
 
-class EconomySelection: public SelectionPolicy {
+class EconomySelection final : public SelectionPolicy {
     public:
         EconomySelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog &facilitiesOptions) override;
         const string toString() const override;
         EconomySelection *clone() const override;
+        int getCyclePosition() const override;
+        bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
+        const string unavailableMessage() const override;
         ~EconomySelection() override = default;
+    protected:
+        void saveState(CheckpointWriter &writer) const override;
+        void loadState(CheckpointReader &reader) override;
     private:
         int lastSelectedIndex;
 
 };
 
-class SustainabilitySelection: public SelectionPolicy {
+class SustainabilitySelection final : public SelectionPolicy {
     public:
         SustainabilitySelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog &facilitiesOptions) override;
         const string toString() const override;
         SustainabilitySelection *clone() const override;
+        int getCyclePosition() const override;
+        bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
+        const string unavailableMessage() const override;
         ~SustainabilitySelection() override = default;
+    protected:
+        void saveState(CheckpointWriter &writer) const override;
+        void loadState(CheckpointReader &reader) override;
     private:
         int lastSelectedIndex;
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "ObjectPool.h"
+#include "SymbolTable.h"
 using std::string;
 using std::vector;
 
@@ -11,16 +13,19 @@ enum class SettlementType {
     CITY,
     METROPOLIS,
 };
+const size_t SETTLEMENT_TYPES = 3;
 
 class Settlement {
     public:
-        Settlement(const string &name, SettlementType type);
+        Settlement(Symbol name, SettlementType type);
         Settlement(const Settlement &settlement);
+        POOLED_OBJECT
         const string &getName() const;
+        Symbol getSymbol() const;
         SettlementType getType() const;
         const string toString() const;
 
         private:
-            const string name;
+            const Symbol name;
             SettlementType type;
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include "Checkpoint.h"
+#include "Simulation.h"
+using std::string;
+using std::vector;
+
+//One message between the coordinator and a shard, in the checkpoint's value layout.
+//On the socket it goes as a 4-byte little-endian length followed by the values.
+class ShardMessage : public ValueWriter, public ValueReader {
+    public:
+        ShardMessage();
+        void writeInt(int value) override;
+        void writeString(const string &value) override;
+        void writeInt64(int64_t value);
+        int readInt() override;
+        string readString() override;
+        int64_t readInt64();
+        bool atEnd() const;
+
+        void assign(const string &bytes); //reads start over
+        const string &bytes() const;
+
+        void send(int fd) const;    //throws std::runtime_error if the other side is gone
+        bool receive(int fd);       //false once the other side has closed the socket
+
+    private:
+        void need(size_t bytes) const;
+
+        string buffer;
+        size_t offset;
+};
+
+//Sharded mode (--shards N): the plans are split across N forked worker processes by the
+//settlement they belong to, so no process holds the whole world. Every worker knows every
+//settlement and facility; commands are sent to all of them, or to the one holding the plan
+//a command names, and their output is merged back into what a single process prints.
+class ShardCoordinator {
+    public:
+        ShardCoordinator(const string &configFilePath, int shardCount); //forks the workers
+        ~ShardCoordinator();                                             //stops them
+        ShardCoordinator(const ShardCoordinator &other) = delete;
+        ShardCoordinator &operator=(const ShardCoordinator &other) = delete;
+
+        void start(bool batch);
+
+    private:
+        enum class Request {
+            COMMAND, COMMANDS, RECORD, STOP  //COMMANDS: several lines, one reply
+        };
+        //what a shard printed and did while running one request
+        struct Reply {
+            Reply() : out(), err(), diagnostics(), allPlans(false), newPlans(), logged() {}
+            string out;
+            string err;
+            vector<PlanDiagnostic> diagnostics;
+            bool allPlans;          //newPlans lists every plan the shard holds, not just the added ones
+            vector<int> newPlans;   //ids of the plans the shard added
+            string logged;          //the actions it logged, in the layout of BaseAction::save
+        };
+
+        static void serve(int fd, const string &configFilePath, int shard, int shardCount);
+        bool runCommand(const string &inputLine); //false once the simulation is closed
+        void send(size_t shard, Request request, const string &argument);
+        void receive(size_t shard, Reply &reply);
+        void broadcast(Request request, const string &argument, vector<Reply> &replies);
+        size_t ownerOf(const string &planId) const;
+
+        static void printMerged(const vector<Reply> &replies);
+        static void printClosed(const vector<Reply> &replies);
+        static void printTop(const vector<Reply> &replies, size_t count);
+        static void printSums(const vector<Reply> &replies, bool (*isPerPlan)(const string &name));
+
+        vector<int> sockets;    //by shard
+        vector<pid_t> workers;  //by shard
+        std::unordered_map<int, size_t> owners; //plan id -> shard
+};
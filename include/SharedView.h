@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Plan.h"
+using std::string;
+using std::vector;
+
+//A POSIX shared memory region (shm_open name) holding the current tick and one entry per
+//plan, in the simulation's plan order. Dashboards map it read-only and poll it without
+//going through the command loop. The layout is fixed-size and native-endian.
+extern const char SHARED_VIEW_MAGIC[8];
+const uint32_t SHARED_VIEW_VERSION = 1;
+
+//Seqlock: the simulation makes sequence odd, writes, then makes it even again. A reader copies
+//what it needs and keeps the copy only if sequence was even and unchanged around the copy.
+struct SharedViewHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;              //plan entries the region has room for; it only grows
+    std::atomic<uint64_t> sequence;
+    int64_t tick;                   //ticks run so far
+    uint32_t planCount;
+    uint32_t reserved;
+};
+
+struct SharedPlanEntry {
+    int32_t planId;
+    int32_t status;                 //0 available, 1 busy
+    int32_t facilities;             //built
+    int32_t underConstruction;
+    int32_t lifeQualityScore;
+    int32_t economyScore;
+    int32_t environmentScore;
+    int32_t reserved;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "the sequence must be a plain 64-bit word");
+
+//The simulation's side. Every change goes between beginWrite and endWrite.
+//Throws std::runtime_error if the region can't be created; it is removed again on destruction.
+class SharedView {
+    public:
+        explicit SharedView(const string &name);
+        ~SharedView();
+        SharedView(const SharedView &other) = delete;
+        SharedView &operator=(const SharedView &other) = delete;
+
+        void beginWrite();
+        void endWrite();
+        void setTick(int64_t tick);
+        void setPlanCount(size_t count);
+        void setPlan(size_t slot, const Plan &plan);
+
+    private:
+        void map(size_t capacity);
+
+        string name;
+        int fd;
+        SharedViewHeader *header;
+        SharedPlanEntry *entries;
+        size_t capacity;
+};
+
+//A dashboard's side: maps the region read-only, and again when it has grown
+class SharedViewReader {
+    public:
+        explicit SharedViewReader(const string &name); //throws std::runtime_error if it isn't there
+        ~SharedViewReader();
+        SharedViewReader(const SharedViewReader &other) = delete;
+        SharedViewReader &operator=(const SharedViewReader &other) = delete;
+
+        //a consistent copy of the tick and the plans; false if every attempt overlapped a write
+        bool read(int64_t &tick, vector<SharedPlanEntry> &plans, int attempts = 1000);
+
+    private:
+        void map(size_t capacity);
+
+        int fd;
+        const SharedViewHeader *header;
+        size_t capacity;
+};
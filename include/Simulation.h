@@ -1,51 +1,117 @@
 #pragma once
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include "ActionLog.h"
+#include "ConstructionScheduler.h"
+#include "CowPtr.h"
 #include "Facility.h"
+#include "FacilityCatalog.h"
+#include "Leaderboard.h"
 #include "Plan.h"
 #include "Settlement.h"
+#include "SymbolTable.h"
 using std::string;
 using std::vector;
 
 
 class BaseAction;
+class CommandJournal;
 class SelectionPolicy;
+class SharedView;
+class ValueWriter;
+
+//What one plan printed on one tick. Sharded plans report these instead of printing them,
+//so the coordinator can put every shard's diagnostics back in tick and plan order.
+struct PlanDiagnostic {
+    int64_t tick;
+    int planId;
+    string text;
+};
 
 class Simulation {
     public:
-        Simulation(const string &configFilePath);
+        //with several shards, only the plans of settlements that hash to this shard are kept
+        Simulation(const string &configFilePath, int shard = 0, int shardCount = 1);
         ~Simulation();                                     
         Simulation(const Simulation &other);              
         Simulation &operator=(const Simulation &other);   
         Simulation(Simulation &&other) noexcept;          
         Simulation &operator=(Simulation &&other) noexcept; 
 
-        void start();
+        void start(bool batch = false); //batch: commands come from a script, so no prompts
+        void runCommand(const string &inputLine); //one line of start's input
         void addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy);
         void addAction(BaseAction *action);
         bool addSettlement(Settlement *settlement);
         bool addFacility(FacilityType facility);
         bool isSettlementExists(const string &settlementName);
+        bool isFacilityExists(const string &facilityName) const;
         Settlement &getSettlement(const string &settlementName);
+        Symbol intern(const string &name); //settlement and facility names are stored once, here
         Plan &getPlan(const int planID);
+        const Plan *findPlan(const int planID) const; //read-only, so backups keep sharing it; nullptr if missing
         void step();
+        void step(int ticks);
+        int64_t getCurrentTick() const; //ticks run so far, the number of the next one
         void close();
         void open();
         SelectionPolicy* createSelectionPolicy(const string& policyType);
-        const std::vector<Plan> &getPlans() const;
-        const std::vector<FacilityType>& getFacilitiesOptions() const;
-        const std::vector<BaseAction*>& getActionsLog() const;
+        const std::vector<CowPtr<Plan>> &getPlans() const;
+        const FacilityCatalog& getFacilitiesOptions() const;
+        const ActionLog &getActionsLog() const;
+        const Leaderboard &getLeaderboard(); //built on first use, then kept up to date as plans change
         void clearPlans();
         void clearSettlements();
+        void saveCheckpoint(const string &path) const;
+        void loadCheckpoint(const string &path);
+        void replay(const string &journalPath);
+        bool ownsSettlement(const string &settlementName) const; //its plans belong to this shard
+        void collectDiagnostics(vector<PlanDiagnostic> *sink); //nullptr prints them as they happen
+        void setActionObserver(ValueWriter *observer);          //every logged action is also saved here
         
 
     private:
+        void configureActionsLog();
+        void openCommandJournal();
+        void openSharedView();
+        void publishView();
+        void runScheduled(ConstructionScheduler &due, int ticks);
+        void stepCollecting(const vector<Plan*> &stepping, int64_t tick);
+
+        //All state is held through CowPtr, so copying a simulation (a backup) only shares it.
+        //Full chunks of the action log and settlements never change once added, so they are shared individually;
+        //plans are copied one at a time, the first time they change after a backup.
         bool isRunning;
         int planCounter; //For assigning unique plan IDs
-        vector<BaseAction*> actionsLog;
-        vector<Plan> plans;
-        vector<Settlement*> settlements;
-        vector<FacilityType> facilitiesOptions;
-        
+        int64_t currentTick;
+        std::shared_ptr<SymbolTable> symbols; //append-only, so shared by every snapshot
+        CowPtr<ActionLog> actionsLog;
+        CowPtr<vector<CowPtr<Plan>>> plans;
+        CowPtr<vector<std::shared_ptr<Settlement>>> settlements;
+        CowPtr<FacilityCatalog> facilitiesOptions;
+
+        //hash indexes kept in sync with the vectors above
+        CowPtr<std::unordered_map<Symbol, Settlement*, SymbolHash>> settlementIndex; //settlement name -> settlement
+        CowPtr<std::unordered_map<int, size_t>> planIndex;                           //plan id -> slot in plans
+        CowPtr<std::unordered_map<Symbol, size_t, SymbolHash>> facilityIndex;        //facility name -> slot in facilitiesOptions
+
+        std::shared_ptr<CommandJournal> journal; //shared with snapshots, so a restore keeps journaling
+        std::shared_ptr<SharedView> view;        //shared with snapshots, so a restore keeps publishing
+
+        //not part of snapshots: rebuilt from the plans whenever they may no longer match them
+        ConstructionScheduler scheduler;
+        bool scheduled;
+        Leaderboard leaderboard;
+        bool ranked;
+        bool published; //the shared view holds every plan as it is now
+
+        //which part of the world this process holds, and where a shard worker's output goes
+        int shard;
+        int shardCount;
+        vector<PlanDiagnostic> *diagnostics;
+        ValueWriter *actionObserver;
 };
-extern Simulation* backup;
\ No newline at end of file
+//named snapshots taken by BackupSimulation; "" is the default one
+extern std::unordered_map<string, Simulation*> backups;
\ No newline at end of file
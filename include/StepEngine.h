@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Plan.h"
+using std::string;
+using std::vector;
+
+//Runs simulation ticks over a set of plans, splitting them across worker threads.
+//Plans never share state, so each chunk is stepped independently and the
+//caller only returns once every chunk is done (a barrier between ticks).
+class StepEngine {
+    public:
+        static StepEngine &instance();
+        ~StepEngine();
+        StepEngine(const StepEngine &other) = delete;
+        StepEngine &operator=(const StepEngine &other) = delete;
+
+        void step(vector<Plan*> &plans, const FacilityCatalog &facilityOptions, int64_t tick);
+        void advance(vector<Plan*> &plans, const FacilityCatalog &facilityOptions, int64_t tick, int ticks);
+        unsigned getThreadCount() const;
+
+    private:
+        explicit StepEngine(unsigned threadCount);
+        void run(vector<Plan*> &plans, const FacilityCatalog &facilityOptions, int64_t tick, int ticks);
+        void workerLoop(size_t worker);
+        void stepChunk(size_t chunk, std::ostream &log);
+        void stepBatched(size_t chunk, size_t begin, size_t end, std::ostream &log);
+
+        //one chunk's plans for a single tick, bucketed by policy kind and settlement type
+        struct Batch {
+            Batch() : groups(), ordered() {}
+            vector<Plan*> groups[POLICY_KINDS * SETTLEMENT_TYPES];
+            vector<Plan*> ordered; //plans that may print a diagnostic or have no known settlement type, in plan order
+        };
+
+        vector<std::thread> workers;
+        vector<string> chunkLogs; //diagnostics of each chunk, flushed in plan order
+        vector<Batch> batches;    //by chunk
+        bool batching;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        vector<Plan*> *plans;
+        const FacilityCatalog *facilityOptions;
+        int64_t tick;   //the first tick to run
+        int ticks;  //0 for a single tick, otherwise each plan is advanced on its own
+        size_t chunkCount;
+        size_t pending;
+        unsigned long generation;
+        bool stopping;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_set>
+using std::string;
+
+//A name interned in a SymbolTable. Every use of a name shares the table's one copy of the
+//text, so symbols from the same table are equal exactly when they point at the same string.
+class Symbol {
+    public:
+        Symbol() : text(nullptr) {}
+        const string &str() const { return *text; }
+        bool isValid() const { return text != nullptr; }
+        bool operator==(const Symbol &other) const { return text == other.text; }
+        bool operator!=(const Symbol &other) const { return text != other.text; }
+
+    private:
+        friend class SymbolTable;
+        friend struct SymbolHash;
+        explicit Symbol(const string *text) : text(text) {}
+
+        const string *text;
+};
+
+struct SymbolHash {
+    size_t operator()(const Symbol &symbol) const { return std::hash<const string *>()(symbol.text); }
+};
+
+//Names are only ever added, so a symbol stays valid for the table's whole life.
+//A simulation and all its snapshots share one table.
+class SymbolTable {
+    public:
+        SymbolTable();
+        Symbol intern(const string &name);
+        Symbol find(const string &name) const; //invalid if the name was never interned
+        size_t size() const;
+
+    private:
+        std::unordered_set<string> names; //nodes never move, so their addresses are the symbols
+};
@@ -4,11 +4,12 @@
 #include "Facility.h"
 #include "Plan.h"
 #include "SelectionPolicy.h"
+#include "Checkpoint.h"
+#include "Metrics.h"
 #include <iostream>
 #include <stdexcept>
 #include <string>
 using namespace std;
-extern Simulation* backup;
 
 BaseAction::BaseAction() : errorMsg(""), status(ActionStatus::COMPLETED) {}
 
@@ -25,14 +26,100 @@ void BaseAction::error(std::string errorMsg) {
     this->errorMsg = errorMsg;
 }
 
+//Stored as type, status and message, then the action's own arguments (checkpoints and action log records)
+void BaseAction::save(ValueWriter &writer) const {
+    writer.writeInt(static_cast<int>(getType()));
+    writer.writeInt(static_cast<int>(status));
+    writer.writeString(errorMsg);
+    saveArguments(writer);
+}
+
+BaseAction *BaseAction::load(ValueReader &reader) {
+    int type = reader.readInt();
+    int status = reader.readInt();
+    string errorMsg = reader.readString();
+    BaseAction *action = nullptr;
+
+    switch (static_cast<ActionType>(type)) {
+        case ActionType::SIMULATE_STEP:
+            action = new SimulateStep(reader.readInt());
+            break;
+        case ActionType::ADD_PLAN: {
+            string settlementName = reader.readString();
+            action = new AddPlan(settlementName, reader.readString());
+            break;
+        }
+        case ActionType::ADD_SETTLEMENT: {
+            string settlementName = reader.readString();
+            action = new AddSettlement(settlementName, static_cast<SettlementType>(reader.readInt()));
+            break;
+        }
+        case ActionType::ADD_FACILITY: {
+            string facilityName = reader.readString();
+            int values[5];
+            for (int &value : values) {
+                value = reader.readInt();
+            }
+            action = new AddFacility(facilityName, static_cast<FacilityCategory>(values[0]), values[1], values[2], values[3], values[4]);
+            break;
+        }
+        case ActionType::PRINT_PLAN_STATUS:
+            action = new PrintPlanStatus(reader.readInt());
+            break;
+        case ActionType::CHANGE_PLAN_POLICY: {
+            int planId = reader.readInt();
+            action = new ChangePlanPolicy(planId, reader.readString());
+            break;
+        }
+        case ActionType::PRINT_ACTIONS_LOG:
+            action = new PrintActionsLog();
+            break;
+        case ActionType::CLOSE:
+            action = new Close();
+            break;
+        case ActionType::BACKUP:
+            action = new BackupSimulation(reader.readString());
+            break;
+        case ActionType::RESTORE:
+            action = new RestoreSimulation(reader.readString());
+            break;
+        case ActionType::SAVE:
+            action = new SaveSimulation(reader.readString());
+            break;
+        case ActionType::LOAD:
+            action = new LoadSimulation(reader.readString());
+            break;
+        case ActionType::REPLAY:
+            action = new ReplayJournal(reader.readString());
+            break;
+        case ActionType::STATS:
+            action = new PrintStats();
+            break;
+        case ActionType::TOP_PLANS: {
+            string metric = reader.readString();
+            action = new TopPlans(metric, reader.readInt());
+            break;
+        }
+        case ActionType::PRINT_WORLD_SCORES:
+            action = new PrintWorldScores();
+            break;
+        default:
+            throw std::runtime_error("Error: Unknown action in checkpoint");
+    }
+
+    action->status = status == static_cast<int>(ActionStatus::ERROR) ? ActionStatus::ERROR : ActionStatus::COMPLETED;
+    action->errorMsg = errorMsg;
+    return action;
+}
+
 Close::Close() {}
 
 void Close::act(Simulation &simulation) {
-    std::cout << "Simulation Results: " << std::endl;
+    std::cout << "Simulation Results: " << '\n';
 
-    for (const Plan &plan : simulation.getPlans()) {
-        std::cout << plan.resultPrint();
-        std::cout << "" << endl;
+    for (const auto &plan : simulation.getPlans()) {
+        std::cout << plan->resultPrint();
+        std::cout << '\n';
     }
     complete();
     simulation.addAction(this);
@@ -46,6 +133,12 @@ Close* Close::clone() const {
     return new Close(*this);
 }
 
+ActionType Close::getType() const {
+    return ActionType::CLOSE;
+}
+
+void Close::saveArguments(ValueWriter &) const {}
+
 //SimulateStep constructor
 SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps) {
     if (numOfSteps <= 0) {
@@ -54,9 +147,7 @@ SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps) {
 }
 
 void SimulateStep::act(Simulation &simulation) {
-    for (int i = 0; i<numOfSteps; i++) {
-        simulation.step();
-    }
+    simulation.step(numOfSteps);
     complete();
     simulation.addAction(this);
 }
@@ -69,6 +160,18 @@ SimulateStep *SimulateStep::clone() const {
     return new SimulateStep(*this);
 }
 
+ActionType SimulateStep::getType() const {
+    return ActionType::SIMULATE_STEP;
+}
+
+int SimulateStep::getNumOfSteps() const {
+    return numOfSteps;
+}
+
+void SimulateStep::saveArguments(ValueWriter &writer) const {
+    writer.writeInt(numOfSteps);
+}
+
 //addSettlement constructor
 AddSettlement::AddSettlement(const string &settlementName, SettlementType settlementType)
     : settlementName(settlementName), settlementType(settlementType) {}
@@ -79,7 +182,7 @@ void AddSettlement::act(Simulation &simulation) {
         return;
     }
     
-    Settlement *newSettlement = new Settlement(settlementName, settlementType);
+    Settlement *newSettlement = new Settlement(simulation.intern(settlementName), settlementType);
         
     if (simulation.addSettlement(newSettlement)) {
         complete();
@@ -100,6 +203,15 @@ AddSettlement *AddSettlement::clone() const {
     return new AddSettlement(*this);
 }
 
+ActionType AddSettlement::getType() const {
+    return ActionType::ADD_SETTLEMENT;
+}
+
+void AddSettlement::saveArguments(ValueWriter &writer) const {
+    writer.writeString(settlementName);
+    writer.writeInt(static_cast<int>(settlementType));
+}
+
 //addPlan
 AddPlan::AddPlan(const std::string &settlementName, const std::string &selectionPolicy)
     : settlementName(settlementName), selectionPolicy(selectionPolicy) {}
@@ -137,6 +249,15 @@ AddPlan *AddPlan::clone() const {
     return new AddPlan(*this);
 }
 
+ActionType AddPlan::getType() const {
+    return ActionType::ADD_PLAN;
+}
+
+void AddPlan::saveArguments(ValueWriter &writer) const {
+    writer.writeString(settlementName);
+    writer.writeString(selectionPolicy);
+}
+
 //Add facility
 AddFacility::AddFacility(const std::string &facilityName, FacilityCategory facilityCategory, int price, int lifeQualityScore, int economyScore, int environmentScore)
     : facilityName(facilityName), facilityCategory(facilityCategory), price(price),
@@ -145,11 +266,9 @@ AddFacility::AddFacility(const std::string &facilityName, FacilityCategory facil
 void AddFacility::act(Simulation &simulation) {
     try {
         //check for duplicates
-        for (const FacilityType &existingFacility : simulation.getFacilitiesOptions()) {
-            if (existingFacility.getName() == facilityName) {
-                error("Error: Facility already exists. ");
-                return;
-            }
+        if (simulation.isFacilityExists(facilityName)) {
+            error("Error: Facility already exists. ");
+            return;
         }
 
         //validating values
@@ -158,7 +277,7 @@ void AddFacility::act(Simulation &simulation) {
             return;
         }
 
-        FacilityType newFacility(facilityName, facilityCategory, price, lifeQualityScore, economyScore, environmentScore);
+        FacilityType newFacility(simulation.intern(facilityName), facilityCategory, price, lifeQualityScore, economyScore, environmentScore);
         simulation.addFacility(newFacility);
         simulation.addAction(this);
         complete();
@@ -176,13 +295,29 @@ AddFacility* AddFacility::clone() const {
     return new AddFacility(*this);
 }
 
+ActionType AddFacility::getType() const {
+    return ActionType::ADD_FACILITY;
+}
+
+void AddFacility::saveArguments(ValueWriter &writer) const {
+    writer.writeString(facilityName);
+    writer.writeInt(static_cast<int>(facilityCategory));
+    writer.writeInt(price);
+    writer.writeInt(lifeQualityScore);
+    writer.writeInt(economyScore);
+    writer.writeInt(environmentScore);
+}
+
 //change plan
 ChangePlanPolicy::ChangePlanPolicy(int planId, const string &newPolicy)
     : planId(planId), newPolicy(newPolicy) {}
 
 void ChangePlanPolicy::act(Simulation &simulation) {
     try {
-        Plan &plan = simulation.getPlan(planId);
+        const Plan *current = simulation.findPlan(planId);
+        if (!current) {
+            throw std::runtime_error("Plan not found");
+        }
         SelectionPolicy *policy = simulation.createSelectionPolicy(newPolicy);
 
         if (!policy) {
@@ -190,13 +325,14 @@ void ChangePlanPolicy::act(Simulation &simulation) {
             return;
         }
 
-        if (plan.isSamePolicy(policy)) {
+        if (current->isSamePolicy(policy)) {
             delete policy;
             error("Error: new policy is the same as the current");
             return;
         }
 
-        plan.setSelectionPolicy(policy);
+        //only now is the plan unshared from any backup
+        simulation.getPlan(planId).setSelectionPolicy(policy);
         simulation.addAction(this);
         complete();
     }
@@ -213,19 +349,29 @@ ChangePlanPolicy *ChangePlanPolicy::clone() const {
     return new ChangePlanPolicy(*this);
 }
 
+ActionType ChangePlanPolicy::getType() const {
+    return ActionType::CHANGE_PLAN_POLICY;
+}
+
+void ChangePlanPolicy::saveArguments(ValueWriter &writer) const {
+    writer.writeInt(planId);
+    writer.writeString(newPolicy);
+}
+
 PrintPlanStatus::PrintPlanStatus(int planId) : planId(planId) {}
 
 void PrintPlanStatus::act(Simulation &simulation) {
     try {
-        for (Plan plan : simulation.getPlans()) {
-            if (planId == plan.getId()) {
-                Plan &plan = simulation.getPlan(planId);
-                std::cout << plan.toString() << std::endl;
-                simulation.addAction(this);
-                complete();
-            }
+        //a missing plan prints nothing and is not logged
+        const Plan *plan = simulation.findPlan(planId);
+        if (!plan) {
+            error("Error: Plan does not exist");
+            return;
         }
-        
+        plan->print(std::cout, simulation.getFacilitiesOptions(), simulation.getCurrentTick());
+        std::cout << '\n';
+        simulation.addAction(this);
+        complete();
     }
     catch (const std::exception &e) {
         error(e.what());
@@ -236,6 +382,14 @@ PrintPlanStatus* PrintPlanStatus::clone() const {
     return new PrintPlanStatus(*this);
 }
 
+ActionType PrintPlanStatus::getType() const {
+    return ActionType::PRINT_PLAN_STATUS;
+}
+
+void PrintPlanStatus::saveArguments(ValueWriter &writer) const {
+    writer.writeInt(planId);
+}
+
 const string PrintPlanStatus::toString() const {
     return "PrintPlanStatus: " + std::to_string(planId);
 }
@@ -244,13 +398,13 @@ PrintActionsLog::PrintActionsLog() {}
 
 void PrintActionsLog::act(Simulation &simulation) {
     try {
-        const auto &actionlog = simulation.getActionsLog();
         std::cout << "Actions Log:\n";
 
-        for (const auto *action : actionlog) {
-            std::cout << action->toString() << " - Status: "
-            << (action->getStatus() == ActionStatus::COMPLETED ? "Completed" : "Error") << "\n";
-        }
+        //records are rebuilt one at a time, so a long log is never materialized
+        simulation.getActionsLog().forEach([](const BaseAction &action) {
+            std::cout << action.toString() << " - Status: "
+            << (action.getStatus() == ActionStatus::COMPLETED ? "Completed" : "Error") << "\n";
+        });
         complete();
     }
     catch (const std::exception &e) {
@@ -266,16 +420,28 @@ PrintActionsLog* PrintActionsLog::clone() const {
     return new PrintActionsLog(*this);
 }
 
+ActionType PrintActionsLog::getType() const {
+    return ActionType::PRINT_ACTIONS_LOG;
+}
+
+void PrintActionsLog::saveArguments(ValueWriter &) const {}
+
 //Backup and Restore
-BackupSimulation::BackupSimulation() {}
+//Snapshots share the simulation's data (see CowPtr), so both actions are O(1)
+BackupSimulation::BackupSimulation() : name("") {}
 
-void BackupSimulation::act(Simulation &simulation) {
+BackupSimulation::BackupSimulation(const string &name) : name(name) {}
 
-    if (backup != nullptr) {
-        delete backup;
+void BackupSimulation::act(Simulation &simulation) {
+    METRIC_TIME(Timer::BACKUP);
+    METRIC_ADD(Counter::BACKUPS, 1);
+    auto found = backups.find(name);
+    if (found != backups.end()) {
+        delete found->second;
+        backups.erase(found);
     }
 
-    backup = new Simulation(simulation);
+    backups[name] = new Simulation(simulation);
     complete();
     simulation.addAction(this);
 }
@@ -284,23 +450,33 @@ BackupSimulation *BackupSimulation::clone() const {
     return new BackupSimulation(*this);
 }
 
+ActionType BackupSimulation::getType() const {
+    return ActionType::BACKUP;
+}
+
+void BackupSimulation::saveArguments(ValueWriter &writer) const {
+    writer.writeString(name);
+}
+
 const string BackupSimulation::toString() const {
-    return "Backup";
+    return name.empty() ? "Backup" : "Backup " + name;
 }
 
-RestoreSimulation::RestoreSimulation() {}
+RestoreSimulation::RestoreSimulation() : name("") {}
+
+RestoreSimulation::RestoreSimulation(const string &name) : name(name) {}
 
+//the snapshot is kept, so it can be restored again later
 void RestoreSimulation::act(Simulation &simulation) {
-    if (backup == nullptr) {
+    METRIC_TIME(Timer::RESTORE);
+    auto found = backups.find(name);
+    if (found == backups.end()) {
         error("No backup available");
         return;
     }
 
-    // simulation.clearPlans();
-    // simulation.clearSettlements();
-
-    // simulation = *backup;
-    std::swap(simulation, *backup);
+    simulation = *found->second;
+    METRIC_ADD(Counter::RESTORES, 1);
 
     complete();
     simulation.addAction(this);
@@ -310,6 +486,200 @@ RestoreSimulation *RestoreSimulation::clone() const {
     return new RestoreSimulation(*this);
 }
 
+ActionType RestoreSimulation::getType() const {
+    return ActionType::RESTORE;
+}
+
+void RestoreSimulation::saveArguments(ValueWriter &writer) const {
+    writer.writeString(name);
+}
+
 const string RestoreSimulation::toString() const {
-    return "Restore";
-}
\ No newline at end of file
+    return name.empty() ? "Restore" : "Restore " + name;
+}
+
+//Save and Load
+SaveSimulation::SaveSimulation(const string &path) : path(path) {}
+
+void SaveSimulation::act(Simulation &simulation) {
+    try {
+        simulation.saveCheckpoint(path);
+        complete();
+    }
+    catch (const std::exception &e) {
+        error(e.what());
+        std::cerr << e.what() << '\n';
+    }
+    simulation.addAction(this);
+}
+
+SaveSimulation *SaveSimulation::clone() const {
+    return new SaveSimulation(*this);
+}
+
+ActionType SaveSimulation::getType() const {
+    return ActionType::SAVE;
+}
+
+void SaveSimulation::saveArguments(ValueWriter &writer) const {
+    writer.writeString(path);
+}
+
+const string SaveSimulation::toString() const {
+    return "Save " + path;
+}
+
+LoadSimulation::LoadSimulation(const string &path) : path(path) {}
+
+//replaces the whole state, like a restore
+void LoadSimulation::act(Simulation &simulation) {
+    try {
+        simulation.loadCheckpoint(path);
+        complete();
+    }
+    catch (const std::exception &e) {
+        //a failed load leaves the state as it was; reported and logged so it doesn't look like one that worked
+        error(e.what());
+        std::cerr << e.what() << '\n';
+    }
+    simulation.addAction(this);
+}
+
+LoadSimulation *LoadSimulation::clone() const {
+    return new LoadSimulation(*this);
+}
+
+ActionType LoadSimulation::getType() const {
+    return ActionType::LOAD;
+}
+
+void LoadSimulation::saveArguments(ValueWriter &writer) const {
+    writer.writeString(path);
+}
+
+const string LoadSimulation::toString() const {
+    return "Load " + path;
+}
+
+ReplayJournal::ReplayJournal(const string &path) : path(path) {}
+
+void ReplayJournal::act(Simulation &simulation) {
+    try {
+        simulation.replay(path);
+        complete();
+    }
+    catch (const std::exception &e) {
+        error(e.what());
+        std::cerr << e.what() << '\n';
+    }
+    simulation.addAction(this);
+}
+
+ReplayJournal *ReplayJournal::clone() const {
+    return new ReplayJournal(*this);
+}
+
+ActionType ReplayJournal::getType() const {
+    return ActionType::REPLAY;
+}
+
+void ReplayJournal::saveArguments(ValueWriter &writer) const {
+    writer.writeString(path);
+}
+
+const string ReplayJournal::toString() const {
+    return "Replay " + path;
+}
+
+PrintStats::PrintStats() {}
+
+void PrintStats::act(Simulation &simulation) {
+#ifdef SIM_NO_METRICS
+    std::cout << "Metrics are not built into this binary" << '\n';
+#else
+    Metrics::instance().print(std::cout);
+#endif
+    complete();
+    simulation.addAction(this);
+}
+
+PrintStats *PrintStats::clone() const {
+    return new PrintStats(*this);
+}
+
+ActionType PrintStats::getType() const {
+    return ActionType::STATS;
+}
+
+void PrintStats::saveArguments(ValueWriter &) const {}
+
+const string PrintStats::toString() const {
+    return "PrintStats";
+}
+
+TopPlans::TopPlans(const string &metric, int count) : metric(metric), count(count) {}
+
+//answered from the simulation's leaderboard, without going over every plan
+void TopPlans::act(Simulation &simulation) {
+    ScoreMetric scoreMetric;
+    if (!Leaderboard::parseMetric(metric, scoreMetric)) {
+        error("Error: unknown metric, expected life, economy, environment or total");
+        return;
+    }
+    if (count < 0) {
+        error("Error: invalid number of plans");
+        return;
+    }
+
+    std::cout << "Top " << count << " plans by " << metric << ":\n";
+    for (const auto &entry : simulation.getLeaderboard().top(scoreMetric, count)) {
+        const Plan *plan = simulation.findPlan(entry.first);
+        std::cout << "PlanID: " << entry.first << ", SettlementName: " << plan->getSettlement().getName()
+                  << ", Score: " << entry.second << "\n";
+    }
+    simulation.addAction(this);
+    complete();
+}
+
+TopPlans *TopPlans::clone() const {
+    return new TopPlans(*this);
+}
+
+ActionType TopPlans::getType() const {
+    return ActionType::TOP_PLANS;
+}
+
+void TopPlans::saveArguments(ValueWriter &writer) const {
+    writer.writeString(metric);
+    writer.writeInt(count);
+}
+
+const string TopPlans::toString() const {
+    return "TopPlans: " + metric + " " + std::to_string(count);
+}
+
+PrintWorldScores::PrintWorldScores() {}
+
+void PrintWorldScores::act(Simulation &simulation) {
+    const Leaderboard &leaderboard = simulation.getLeaderboard();
+    std::cout << "Plans: " << leaderboard.size() << "\n";
+    std::cout << "LifeQualityScore: " << leaderboard.getTotal(ScoreMetric::LIFE_QUALITY) << "\n";
+    std::cout << "EconomyScore: " << leaderboard.getTotal(ScoreMetric::ECONOMY) << "\n";
+    std::cout << "EnvironmentScore: " << leaderboard.getTotal(ScoreMetric::ENVIRONMENT) << "\n";
+    simulation.addAction(this);
+    complete();
+}
+
+PrintWorldScores *PrintWorldScores::clone() const {
+    return new PrintWorldScores(*this);
+}
+
+ActionType PrintWorldScores::getType() const {
+    return ActionType::PRINT_WORLD_SCORES;
+}
+
+void PrintWorldScores::saveArguments(ValueWriter &) const {}
+
+const string PrintWorldScores::toString() const {
+    return "PrintWorldScores";
+}
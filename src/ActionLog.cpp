@@ -0,0 +1,258 @@
+#include "ActionLog.h"
+#include "Action.h"
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+//Fills a record from the values an action stores
+class RecordWriter : public ValueWriter {
+    public:
+        RecordWriter(ActionRecord &record, StringPool &strings) : record(record), strings(strings) {
+            record.count = 0;
+            record.stringMask = 0;
+        }
+        RecordWriter(const RecordWriter &other) = delete;
+        RecordWriter &operator=(const RecordWriter &other) = delete;
+
+        void writeInt(int value) override {
+            next() = value;
+        }
+
+        void writeString(const string &value) override {
+            record.stringMask |= 1 << record.count;
+            next() = strings.intern(value);
+        }
+
+    private:
+        int32_t &next() {
+            if (record.count >= ACTION_RECORD_FIELDS) {
+                throw std::logic_error("Error: Action has too many arguments for the log");
+            }
+            return record.fields[record.count++];
+        }
+
+        ActionRecord &record;
+        StringPool &strings;
+};
+
+//Gives the values of a record back in the order they were written
+class RecordReader : public ValueReader {
+    public:
+        RecordReader(const ActionRecord &record, const StringPool &strings) : record(record), strings(strings), position(0) {}
+        RecordReader(const RecordReader &other) = delete;
+        RecordReader &operator=(const RecordReader &other) = delete;
+
+        int readInt() override {
+            return next(false);
+        }
+
+        string readString() override {
+            return strings.get(next(true));
+        }
+
+    private:
+        int next(bool isString) {
+            if (position >= record.count || ((record.stringMask >> position) & 1) != isString) {
+                throw std::runtime_error("Error: Corrupt action log record");
+            }
+            return record.fields[position++];
+        }
+
+        const ActionRecord &record;
+        const StringPool &strings;
+        int position;
+};
+
+//String pool
+StringPool::StringPool(const std::shared_ptr<SymbolTable> &symbols) : symbols(symbols), ids(), strings() {}
+
+int StringPool::intern(const string &value) {
+    Symbol symbol = symbols->intern(value);
+    auto found = ids.find(symbol);
+    if (found != ids.end()) {
+        return found->second;
+    }
+    int id = static_cast<int>(strings.size());
+    strings.push_back(symbol);
+    ids.emplace(symbol, id);
+    return id;
+}
+
+const string &StringPool::get(int id) const {
+    if (id < 0 || static_cast<size_t>(id) >= strings.size()) {
+        throw std::runtime_error("Error: Corrupt action log record");
+    }
+    return strings[id].str();
+}
+
+size_t StringPool::size() const {
+    return strings.size();
+}
+
+//Journal
+ActionJournal::ActionJournal(const string &path) : fd(-1), end(0) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Can't open action journal: " + path);
+    }
+}
+
+ActionJournal::~ActionJournal() {
+    ::close(fd);
+}
+
+int64_t ActionJournal::append(const ActionRecord *records, size_t count) {
+    int64_t offset = end;
+    const char *data = reinterpret_cast<const char *>(records);
+    size_t left = count * sizeof(ActionRecord);
+    while (left > 0) {
+        ssize_t written = ::pwrite(fd, data, left, end);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Error: Can't write the action journal");
+        }
+        data += written;
+        left -= written;
+        end += written;
+    }
+    return offset;
+}
+
+void ActionJournal::read(int64_t offset, ActionRecord *records, size_t count) const {
+    char *data = reinterpret_cast<char *>(records);
+    size_t left = count * sizeof(ActionRecord);
+    while (left > 0) {
+        ssize_t got = ::pread(fd, data, left, offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            throw std::runtime_error("Error: Can't read the action journal");
+        }
+        data += got;
+        left -= got;
+        offset += got;
+    }
+}
+
+//Action log
+ActionLog::ActionLog() : ActionLog(std::make_shared<SymbolTable>()) {}
+
+ActionLog::ActionLog(const std::shared_ptr<SymbolTable> &symbols)
+    : chunks(), dropped(0), count(0), limit(0), spilled(),
+      strings(std::make_shared<StringPool>(symbols)), journal() {}
+
+void ActionLog::configure(size_t limit, const string &journalPath) {
+    this->limit = limit;
+    journal.reset();
+    if (!journalPath.empty()) {
+        journal = std::make_shared<ActionJournal>(journalPath);
+    }
+    trim();
+}
+
+ActionLog ActionLog::cleared() const {
+    ActionLog log;
+    log.limit = limit;
+    log.strings = strings;
+    log.journal = journal;
+    return log;
+}
+
+void ActionLog::append(const BaseAction &action) {
+    ActionRecord record = ActionRecord();
+    RecordWriter writer(record, *strings);
+    action.save(writer);
+
+    if (count % CHUNK_RECORDS == 0) {
+        chunks.push_back(std::make_shared<Chunk>());
+        chunks.back()->reserve(CHUNK_RECORDS);
+    }
+    else if (chunks.back().use_count() > 1) {
+        //a snapshot still lists this chunk up to its own count
+        std::shared_ptr<Chunk> own = std::make_shared<Chunk>();
+        own->reserve(CHUNK_RECORDS);
+        own->assign(chunks.back()->begin(), chunks.back()->begin() + count % CHUNK_RECORDS);
+        chunks.back() = own;
+    }
+    chunks.back()->push_back(record);
+    count++;
+    trim();
+}
+
+//drops full chunks from the front while the rest still holds limit records
+void ActionLog::trim() {
+    if (limit == 0) {
+        return;
+    }
+    while (chunks.size() > 1 && count - (dropped + 1) * CHUNK_RECORDS >= limit) {
+        if (journal) {
+            spilled.push_back(journal->append(chunks.front()->data(), CHUNK_RECORDS));
+        }
+        chunks.pop_front();
+        dropped++;
+    }
+}
+
+//with a journal nothing is lost; without one only the newest limit records are listed
+size_t ActionLog::firstListed() const {
+    size_t first = dropped * CHUNK_RECORDS;
+    if (!journal && limit > 0 && count > limit && count - limit > first) {
+        first = count - limit;
+    }
+    return first;
+}
+
+size_t ActionLog::size() const {
+    return journal ? spilled.size() * CHUNK_RECORDS + (count - dropped * CHUNK_RECORDS) : count - firstListed();
+}
+
+void ActionLog::forEachRecord(const std::function<void(const ActionRecord &)> &visit) const {
+    if (journal) {
+        Chunk buffer(CHUNK_RECORDS);
+        for (int64_t offset : spilled) {
+            journal->read(offset, buffer.data(), CHUNK_RECORDS);
+            for (const ActionRecord &record : buffer) {
+                visit(record);
+            }
+        }
+    }
+    for (size_t number = firstListed(); number < count; ++number) {
+        const Chunk &chunk = *chunks[number / CHUNK_RECORDS - dropped];
+        visit(chunk[number % CHUNK_RECORDS]);
+    }
+}
+
+void ActionLog::forEach(const std::function<void(const BaseAction &)> &visit) const {
+    forEachRecord([this, &visit](const ActionRecord &record) {
+        RecordReader reader(record, *strings);
+        std::unique_ptr<BaseAction> action(BaseAction::load(reader));
+        visit(*action);
+    });
+}
+
+//Checkpoint - the same layout as BaseAction::save, written straight from the records
+void ActionLog::save(CheckpointWriter &writer) const {
+    writer.writeInt(static_cast<int>(size()));
+    forEachRecord([this, &writer](const ActionRecord &record) {
+        for (int i = 0; i < record.count; ++i) {
+            if ((record.stringMask >> i) & 1) {
+                writer.writeString(strings->get(record.fields[i]));
+            }
+            else {
+                writer.writeInt(record.fields[i]);
+            }
+        }
+    });
+}
+
+void ActionLog::load(CheckpointReader &reader) {
+    int actions = reader.readInt();
+    for (int i = 0; i < actions; ++i) {
+        std::unique_ptr<BaseAction> action(BaseAction::load(reader));
+        append(*action);
+    }
+}
@@ -0,0 +1,65 @@
+#include "BatchIO.h"
+#include <cerrno>
+#include <unistd.h>
+
+//Input
+BlockInputBuffer::BlockInputBuffer(int fd, size_t size) : fd(fd), buffer(size) {
+    setg(buffer.data(), buffer.data(), buffer.data());
+}
+
+BlockInputBuffer::int_type BlockInputBuffer::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    ssize_t count;
+    do {
+        count = ::read(fd, buffer.data(), buffer.size());
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        return traits_type::eof();
+    }
+    setg(buffer.data(), buffer.data(), buffer.data() + count);
+    return traits_type::to_int_type(*gptr());
+}
+
+//Output
+BlockOutputBuffer::BlockOutputBuffer(int fd, size_t size) : fd(fd), buffer(size) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+BlockOutputBuffer::~BlockOutputBuffer() {
+    writeOut();
+}
+
+BlockOutputBuffer::int_type BlockOutputBuffer::overflow(int_type c) {
+    if (!writeOut()) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int BlockOutputBuffer::sync() {
+    return writeOut() ? 0 : -1;
+}
+
+//writes out everything buffered so far, retrying short writes
+bool BlockOutputBuffer::writeOut() {
+    const char *next = pbase();
+    while (next < pptr()) {
+        ssize_t count = ::write(fd, next, pptr() - next);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        next += count;
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return true;
+}
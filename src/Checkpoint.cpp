@@ -0,0 +1,116 @@
+#include "Checkpoint.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char CHECKPOINT_MAGIC[8] = {'S', 'P', 'L', 'C', 'K', 'P', 'T', '\0'};
+
+//Writer - the header goes in first
+CheckpointWriter::CheckpointWriter() : buffer(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) {
+    writeInt(CHECKPOINT_VERSION);
+}
+
+void CheckpointWriter::writeInt(int value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+}
+
+void CheckpointWriter::writeString(const string &value) {
+    writeInt(static_cast<int>(value.size()));
+    buffer.append(value);
+}
+
+void CheckpointWriter::saveTo(const string &path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error: Can't open checkpoint file: " + path);
+    }
+    file.write(buffer.data(), buffer.size());
+    if (!file) {
+        throw std::runtime_error("Error: Can't write checkpoint file: " + path);
+    }
+}
+
+//Reader constructor - maps the file and checks the header
+CheckpointReader::CheckpointReader(const string &path) : fd(-1), data(nullptr), size(0), offset(0) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Can't open checkpoint file: " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(CHECKPOINT_MAGIC) + 4)) {
+        ::close(fd);
+        throw std::runtime_error("Error: Not a checkpoint file: " + path);
+    }
+
+    size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Error: Can't map checkpoint file: " + path);
+    }
+    data = static_cast<const unsigned char *>(mapping);
+
+    if (std::memcmp(data, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        release();
+        throw std::runtime_error("Error: Not a checkpoint file: " + path);
+    }
+    offset = sizeof(CHECKPOINT_MAGIC);
+    if (readInt() != CHECKPOINT_VERSION) {
+        release();
+        throw std::runtime_error("Error: Unsupported checkpoint version: " + path);
+    }
+}
+
+CheckpointReader::~CheckpointReader() {
+    release();
+}
+
+void CheckpointReader::release() {
+    if (data != nullptr) {
+        ::munmap(const_cast<unsigned char *>(data), size);
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void CheckpointReader::need(size_t bytes) const {
+    if (size - offset < bytes) {
+        throw std::runtime_error("Error: Checkpoint file is truncated");
+    }
+}
+
+int CheckpointReader::readInt() {
+    need(4);
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+        bits |= static_cast<uint32_t>(data[offset + i]) << (8 * i);
+    }
+    offset += 4;
+    return static_cast<int>(bits);
+}
+
+string CheckpointReader::readString() {
+    int length = readInt();
+    if (length < 0) {
+        throw std::runtime_error("Error: Checkpoint file is corrupt");
+    }
+    need(length);
+    string value(reinterpret_cast<const char *>(data + offset), length);
+    offset += length;
+    return value;
+}
+
+bool CheckpointReader::atEnd() const {
+    return offset == size;
+}
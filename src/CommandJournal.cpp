@@ -0,0 +1,252 @@
+#include "CommandJournal.h"
+#include "Action.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char JOURNAL_MAGIC[8] = {'S', 'P', 'L', 'J', 'R', 'N', 'L', '\0'};
+
+static const size_t HEADER_BYTES = sizeof(JOURNAL_MAGIC) + 4;  //magic and version
+static const size_t RECORD_HEADER_BYTES = 8;                   //length and checksum
+
+static void putUint32(string &data, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static uint32_t getUint32(const string &data, size_t offset) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+static uint32_t checksum(const char *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+//true if a whole record whose checksum matches starts at offset; length is the size of its action
+static bool isWholeRecord(const string &data, size_t offset, size_t &length) {
+    if (data.size() - offset < RECORD_HEADER_BYTES) {
+        return false;
+    }
+    length = getUint32(data, offset);
+    return length <= data.size() - offset - RECORD_HEADER_BYTES &&
+           getUint32(data, offset + 4) == checksum(data.data() + offset + RECORD_HEADER_BYTES, length);
+}
+
+static bool readAll(int fd, string &data) {
+    size_t got = 0;
+    while (got < data.size()) {
+        ssize_t count = ::pread(fd, &data[got], data.size() - got, got);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        got += count;
+    }
+    return true;
+}
+
+//Writer - a new file gets the header, an existing one must already have it and is cut back
+//to its last whole record before anything is appended
+CommandJournal::CommandJournal(const string &path) : fd(-1), suspended(false), buffer(), cutBytes(0) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Can't open command journal: " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Error: Can't open command journal: " + path);
+    }
+    if (info.st_size == 0) {
+        buffer.assign(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        writeInt(JOURNAL_VERSION);
+        flush();
+        return;
+    }
+
+    string data(static_cast<size_t>(info.st_size), '\0');
+    if (!readAll(fd, data) || data.size() < HEADER_BYTES || std::memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Error: Not a command journal: " + path);
+    }
+    if (getUint32(data, sizeof(JOURNAL_MAGIC)) != static_cast<uint32_t>(JOURNAL_VERSION)) {
+        ::close(fd);
+        throw std::runtime_error("Error: Unsupported command journal version: " + path);
+    }
+
+    size_t end = HEADER_BYTES;
+    size_t length = 0;
+    while (isWholeRecord(data, end, length)) {
+        end += RECORD_HEADER_BYTES + length;
+    }
+    if (end < data.size()) {
+        if (::ftruncate(fd, static_cast<off_t>(end)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Error: Can't repair command journal: " + path);
+        }
+        cutBytes = data.size() - end;
+    }
+}
+
+CommandJournal::~CommandJournal() {
+    ::close(fd);
+}
+
+//Steps, plans, settlements, facilities, policy changes, backups, restores and loads
+bool CommandJournal::isJournaled(ActionType type) {
+    switch (type) {
+        case ActionType::SIMULATE_STEP:
+        case ActionType::ADD_PLAN:
+        case ActionType::ADD_SETTLEMENT:
+        case ActionType::ADD_FACILITY:
+        case ActionType::CHANGE_PLAN_POLICY:
+        case ActionType::BACKUP:
+        case ActionType::RESTORE:
+        case ActionType::LOAD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void CommandJournal::record(const BaseAction &action) {
+    if (suspended || action.getStatus() != ActionStatus::COMPLETED || !isJournaled(action.getType())) {
+        return;
+    }
+    buffer.assign(RECORD_HEADER_BYTES, '\0');
+    action.save(*this);
+
+    string header;
+    putUint32(header, static_cast<uint32_t>(buffer.size() - RECORD_HEADER_BYTES));
+    putUint32(header, checksum(buffer.data() + RECORD_HEADER_BYTES, buffer.size() - RECORD_HEADER_BYTES));
+    buffer.replace(0, RECORD_HEADER_BYTES, header);
+    flush();
+}
+
+bool CommandJournal::isSameFile(const string &path) const {
+    struct stat mine, other;
+    return ::fstat(fd, &mine) == 0 && ::stat(path.c_str(), &other) == 0 &&
+           mine.st_dev == other.st_dev && mine.st_ino == other.st_ino;
+}
+
+void CommandJournal::setSuspended(bool suspended) {
+    this->suspended = suspended;
+}
+
+size_t CommandJournal::getCutBytes() const {
+    return cutBytes;
+}
+
+void CommandJournal::writeInt(int value) {
+    putUint32(buffer, static_cast<uint32_t>(value));
+}
+
+void CommandJournal::writeString(const string &value) {
+    writeInt(static_cast<int>(value.size()));
+    buffer.append(value);
+}
+
+void CommandJournal::flush() {
+    const char *data = buffer.data();
+    size_t left = buffer.size();
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Error: Can't write the command journal");
+        }
+        data += written;
+        left -= written;
+    }
+    buffer.clear();
+}
+
+//Reader constructor - loads the file and checks the header
+JournalReader::JournalReader(const string &path) : data(), offset(0), recordEnd(0) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error: Can't open command journal: " + path);
+    }
+    file.seekg(0, std::ios::end);
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(&data[0], data.size());
+
+    if (data.size() < HEADER_BYTES || std::memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+        throw std::runtime_error("Error: Not a command journal: " + path);
+    }
+    if (getUint32(data, sizeof(JOURNAL_MAGIC)) != static_cast<uint32_t>(JOURNAL_VERSION)) {
+        throw std::runtime_error("Error: Unsupported command journal version: " + path);
+    }
+    offset = HEADER_BYTES;
+    recordEnd = offset;
+}
+
+void JournalReader::beginRecord() {
+    recordEnd = data.size();
+    need(RECORD_HEADER_BYTES);
+    size_t length = getUint32(data, offset);
+    uint32_t sum = getUint32(data, offset + 4);
+    offset += RECORD_HEADER_BYTES;
+    need(length);
+    if (checksum(data.data() + offset, length) != sum) {
+        throw std::runtime_error("Error: Command journal record fails its checksum");
+    }
+    recordEnd = offset + length;
+}
+
+void JournalReader::endRecord() {
+    if (offset != recordEnd) {
+        throw std::runtime_error("Error: Command journal is corrupt");
+    }
+}
+
+void JournalReader::need(size_t bytes) const {
+    if (recordEnd - offset < bytes) {
+        throw std::runtime_error("Error: Command journal is truncated");
+    }
+}
+
+int JournalReader::readInt() {
+    need(4);
+    int value = static_cast<int>(getUint32(data, offset));
+    offset += 4;
+    return value;
+}
+
+string JournalReader::readString() {
+    int length = readInt();
+    if (length < 0) {
+        throw std::runtime_error("Error: Command journal is corrupt");
+    }
+    need(length);
+    string value(data, offset, length);
+    offset += length;
+    return value;
+}
+
+bool JournalReader::atEnd() const {
+    return offset == data.size();
+}
+
+size_t JournalReader::getOffset() const {
+    return offset;
+}
@@ -0,0 +1,169 @@
+#include "ConfigLoader.h"
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//same separators std::istringstream skips, so CRLF files still work
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+//ConfigToken
+bool ConfigToken::operator==(const char *word) const {
+    return std::strlen(word) == length && std::memcmp(begin, word, length) == 0;
+}
+
+bool ConfigToken::operator!=(const char *word) const {
+    return !(*this == word);
+}
+
+string ConfigToken::str() const {
+    return string(begin, length);
+}
+
+//Parses an optionally signed decimal integer spanning the whole token
+bool ConfigToken::toInt(int &value) const {
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (begin[i] == '-' || begin[i] == '+')) {
+        negative = begin[i] == '-';
+        i++;
+    }
+    if (i == length) {
+        return false;
+    }
+
+    long long result = 0;
+    for (; i < length; ++i) {
+        if (begin[i] < '0' || begin[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (begin[i] - '0');
+        if (result > static_cast<long long>(INT_MAX) + 1) {
+            return false;
+        }
+    }
+
+    result = negative ? -result : result;
+    if (result > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(result);
+    return true;
+}
+
+//ConfigLoader constructor - maps the whole file read-only
+ConfigLoader::ConfigLoader(const string &configFilePath)
+    : fd(-1), data(nullptr), size(0), cursor(nullptr), lineBegin(nullptr), lineEnd(nullptr), lineNumber(0) {
+    fd = ::open(configFilePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            fd = -1;
+            size = 0;
+            return;
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+    }
+    cursor = data;
+}
+
+ConfigLoader::~ConfigLoader() {
+    if (data != nullptr) {
+        ::munmap(const_cast<char *>(data), size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool ConfigLoader::isOpen() const {
+    return fd >= 0;
+}
+
+size_t ConfigLoader::getLineNumber() const {
+    return lineNumber;
+}
+
+//the current line as text, for error messages
+string ConfigLoader::getLine() const {
+    return string(lineBegin, lineEnd - lineBegin);
+}
+
+//Moves to the next line and splits it into tokens, returns false at end of file
+bool ConfigLoader::nextLine(vector<ConfigToken> &tokens) {
+    tokens.clear();
+    const char *end = data + size;
+    if (cursor == nullptr || cursor >= end) {
+        return false;
+    }
+
+    lineBegin = cursor;
+    const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));
+    lineEnd = newline != nullptr ? newline : end;
+    cursor = newline != nullptr ? newline + 1 : end;
+    lineNumber++;
+
+    const char *p = lineBegin;
+    while (p < lineEnd) {
+        while (p < lineEnd && isSpace(*p)) {
+            p++;
+        }
+        const char *word = p;
+        while (p < lineEnd && !isSpace(*p)) {
+            p++;
+        }
+        if (p > word) {
+            ConfigToken token = {word, static_cast<size_t>(p - word)};
+            tokens.push_back(token);
+        }
+    }
+    return true;
+}
+
+//Counting pass over the first word of every line, so the containers can be reserved up front
+void ConfigLoader::countRecords(size_t &settlements, size_t &facilities, size_t &plans) const {
+    settlements = facilities = plans = 0;
+    const char *p = data;
+    const char *end = data + size;
+
+    while (p != nullptr && p < end) {
+        while (p < end && isSpace(*p)) {
+            p++;
+        }
+        const char *word = p;
+        while (p < end && !isSpace(*p) && *p != '\n') {
+            p++;
+        }
+        ConfigToken token = {word, static_cast<size_t>(p - word)};
+        if (token == "settlement") {
+            settlements++;
+        }
+        else if (token == "facility") {
+            facilities++;
+        }
+        else if (token == "plan") {
+            plans++;
+        }
+
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        p = newline != nullptr ? newline + 1 : end;
+    }
+}
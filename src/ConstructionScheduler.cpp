@@ -0,0 +1,77 @@
+#include "ConstructionScheduler.h"
+#include <algorithm>
+#include <limits>
+
+ConstructionScheduler::ConstructionScheduler()
+    : wheel(WHEEL_TICKS), counts(WHEEL_TICKS, 0), words(0), base(0), wheeled(0), later() {}
+
+void ConstructionScheduler::clear(int64_t tick) {
+    for (vector<uint64_t> &bucket : wheel) {
+        std::fill(bucket.begin(), bucket.end(), 0);
+    }
+    std::fill(counts.begin(), counts.end(), 0);
+    wheeled = 0;
+    later = std::priority_queue<Entry, vector<Entry>, std::greater<Entry>>();
+    base = tick;
+}
+
+//a tick the wheel has already passed counts as the earliest one it still holds
+void ConstructionScheduler::add(size_t slot, int64_t tick) {
+    int64_t due = std::max(tick, base);
+    if (due >= base + WHEEL_TICKS) {
+        later.push(Entry(due, slot));
+        return;
+    }
+
+    if (slot / 64 >= words) {
+        words = slot / 64 + 1;
+        for (vector<uint64_t> &bucket : wheel) {
+            bucket.resize(words, 0);
+        }
+    }
+    size_t bucket = static_cast<size_t>(due % WHEEL_TICKS);
+    wheel[bucket][slot / 64] |= uint64_t(1) << (slot % 64);
+    counts[bucket]++;
+    wheeled++;
+}
+
+int64_t ConstructionScheduler::nextTick() const {
+    int64_t next = later.empty() ? std::numeric_limits<int64_t>::max() : later.top().first;
+    if (wheeled != 0) {
+        for (int64_t tick = base; tick < base + WHEEL_TICKS && tick < next; ++tick) {
+            if (counts[tick % WHEEL_TICKS] != 0) {
+                return tick;
+            }
+        }
+    }
+    return next;
+}
+
+//Only call with nextTick(): every earlier bucket is empty, so after it the wheel starts one tick later
+void ConstructionScheduler::takeDue(int64_t tick, vector<size_t> &due) {
+    due.clear();
+    if (tick < base + WHEEL_TICKS) {
+        size_t index = static_cast<size_t>(tick % WHEEL_TICKS);
+        vector<uint64_t> &bucket = wheel[index];
+        for (size_t word = 0; counts[index] != 0 && word < words; ++word) {
+            for (uint64_t bits = bucket[word]; bits != 0; bits &= bits - 1) {
+                due.push_back(word * 64 + __builtin_ctzll(bits));
+                counts[index]--;
+            }
+            bucket[word] = 0;
+        }
+        wheeled -= due.size();
+    }
+    base = tick + 1;
+
+    //plans that slept past the wheel are merged in, keeping slot order
+    size_t wheeledDue = due.size();
+    while (!later.empty() && later.top().first <= tick) {
+        due.push_back(later.top().second);
+        later.pop();
+    }
+    if (wheeledDue != due.size()) {
+        std::sort(due.begin() + wheeledDue, due.end());
+        std::inplace_merge(due.begin(), due.begin() + wheeledDue, due.end());
+    }
+}
@@ -1,10 +1,11 @@
 #include "Facility.h"
+#include "Checkpoint.h"
 #include <sstream>
 #include <iostream>
 using std::string;
 
 //FacilityType Constructor
-FacilityType::FacilityType(const string &name, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score)
+FacilityType::FacilityType(Symbol name, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score)
     :name(name), category(category), price(price),
     lifeQuality_score(lifeQuality_score), economy_score(economy_score), environment_score(environment_score){}
 
@@ -12,12 +13,17 @@ FacilityType *FacilityType::clone() const {
     return new FacilityType(*this);
 }
 
+//names are interned, so this compares two pointers
 bool FacilityType::operator==(const FacilityType& other) const {
-    return this->name == other.name; // Compare by name or another unique field
+    return this->name == other.name;
 }
 
 // Getters for FacilityType
 const string &FacilityType::getName() const{
+    return name.str();
+}
+
+Symbol FacilityType::getSymbol() const {
     return name;
 }
 
@@ -41,11 +47,35 @@ int FacilityType::getLifeQualityScore() const {
     return lifeQuality_score;
 }
 
+//Checkpoint
+void FacilityType::save(CheckpointWriter &writer) const {
+    writer.writeString(name.str());
+    writer.writeInt(static_cast<int>(category));
+    writer.writeInt(price);
+    writer.writeInt(lifeQuality_score);
+    writer.writeInt(economy_score);
+    writer.writeInt(environment_score);
+}
+
+FacilityType FacilityType::load(CheckpointReader &reader, SymbolTable &symbols) {
+    string name = reader.readString();
+    int category = reader.readInt(); //the facility command does not check it either; see FacilityCatalog::add
+    int price = reader.readInt();
+    int lifeQualityScore = reader.readInt();
+    int economyScore = reader.readInt();
+    int environmentScore = reader.readInt();
+    return FacilityType(symbols.intern(name), static_cast<FacilityCategory>(category), price, lifeQualityScore, economyScore, environmentScore);
+}
+
 // Facility constructor
-Facility::Facility(const FacilityType &type, const string &settlementName)
+Facility::Facility(const FacilityType &type, Symbol settlementName)
     :FacilityType(type), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(price){}
 
-Facility::Facility(const string &name, const string &settlementName, const FacilityCategory category, const int price,const int lifeQuality_score, const int economy_score, const int environment_score) 
+//Rebuilds a facility from a plan's compact construction store
+Facility::Facility(const FacilityType &type, Symbol settlementName, FacilityStatus status, int timeLeft)
+    :FacilityType(type), settlementName(settlementName), status(status), timeLeft(timeLeft){}
+
+Facility::Facility(Symbol name, Symbol settlementName, const FacilityCategory category, const int price,const int lifeQuality_score, const int economy_score, const int environment_score) 
                    : FacilityType(name, category, price, lifeQuality_score, economy_score, environment_score),
                      settlementName(settlementName),
                      status(FacilityStatus::UNDER_CONSTRUCTIONS),
@@ -54,7 +84,7 @@ Facility::Facility(const string &name, const string &settlementName, const Facil
 
 //Facility getter's and setter's
 const string &Facility::getSettlementName() const {
-    return settlementName;
+    return settlementName.str();
 }
 
 const FacilityStatus& Facility::getStatus() const {
@@ -88,9 +118,13 @@ FacilityStatus Facility::step(){
 
 const string Facility::toString() const {
     std::ostringstream oss;
-    oss << "Facility Name: " << getName()
-        << ", Settlement: " << settlementName
-        <<", Status: " << (getStatus() == FacilityStatus::UNDER_CONSTRUCTIONS ? "Under Construction" : "Operational")
-        <<", Time Left: " << getTimeLeft();
+    describe(oss, getName(), settlementName.str(), getStatus(), getTimeLeft());
     return oss.str();
+}
+
+void Facility::describe(std::ostream &out, const string &name, const string &settlementName, FacilityStatus status, int timeLeft) {
+    out << "Facility Name: " << name
+        << ", Settlement: " << settlementName
+        <<", Status: " << (status == FacilityStatus::UNDER_CONSTRUCTIONS ? "Under Construction" : "Operational")
+        <<", Time Left: " << timeLeft;
 }
\ No newline at end of file
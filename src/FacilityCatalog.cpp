@@ -0,0 +1,152 @@
+#include "FacilityCatalog.h"
+#include <climits>
+
+//number of FacilityCategory values
+static const size_t CATEGORY_COUNT = 3;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+FacilityCatalog::FacilityCatalog()
+    : facilities(), lifeQualityScores(), economyScores(), environmentScores(),
+      nextByCategory(CATEGORY_COUNT) {}
+
+void FacilityCatalog::reserve(size_t count) {
+    facilities.reserve(count);
+    lifeQualityScores.reserve(count);
+    economyScores.reserve(count);
+    environmentScores.reserve(count);
+    for (vector<int> &next : nextByCategory) {
+        next.reserve(count);
+    }
+}
+
+void FacilityCatalog::add(const FacilityType &facility) {
+    facilities.emplace_back(facility);
+    lifeQualityScores.push_back(facility.getLifeQualityScore());
+    economyScores.push_back(facility.getEconomyScore());
+    environmentScores.push_back(facility.getEnvironmentScore());
+
+    int index = static_cast<int>(facilities.size()) - 1;
+    for (vector<int> &next : nextByCategory) {
+        next.push_back(-1);
+    }
+    //the positions after the previous facility of this category now lead to the new one
+    size_t category = static_cast<size_t>(facility.getCategory());
+    if (category >= CATEGORY_COUNT) {
+        return; //the facility command does not check the category; such facilities match no policy
+    }
+    vector<int> &next = nextByCategory[category];
+    for (int i = index; i >= 0 && next[i] == -1; --i) {
+        next[i] = index;
+    }
+}
+
+size_t FacilityCatalog::size() const {
+    return facilities.size();
+}
+
+bool FacilityCatalog::empty() const {
+    return facilities.empty();
+}
+
+const FacilityType &FacilityCatalog::operator[](size_t index) const {
+    return facilities[index];
+}
+
+//position of a facility returned by operator[]
+int FacilityCatalog::indexOf(const FacilityType &facility) const {
+    return static_cast<int>(&facility - facilities.data());
+}
+
+const vector<FacilityType> &FacilityCatalog::getFacilities() const {
+    return facilities;
+}
+
+//Balanced scoring kernel. The distance max - a + max - b + max - c is computed as
+//3 * max - (a + b + c), four candidates at a time when SSE2 is available. Blocks are
+//scanned in index order with a strict <, so ties keep going to the first facility.
+int FacilityCatalog::findMostBalanced(int lifeQualityScore, int economyScore, int environmentScore) const {
+    const int count = static_cast<int>(facilities.size());
+    const int *life = lifeQualityScores.data();
+    const int *economy = economyScores.data();
+    const int *environment = environmentScores.data();
+    int bestIndex = -1;
+    int smallestDistance = INT_MAX;
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i baseLife = _mm_set1_epi32(lifeQualityScore);
+    const __m128i baseEconomy = _mm_set1_epi32(economyScore);
+    const __m128i baseEnvironment = _mm_set1_epi32(environmentScore);
+    alignas(16) int distances[4];
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_add_epi32(baseLife, _mm_loadu_si128(reinterpret_cast<const __m128i *>(life + i)));
+        __m128i b = _mm_add_epi32(baseEconomy, _mm_loadu_si128(reinterpret_cast<const __m128i *>(economy + i)));
+        __m128i c = _mm_add_epi32(baseEnvironment, _mm_loadu_si128(reinterpret_cast<const __m128i *>(environment + i)));
+
+        //SSE2 has no 32 bit max, so lanes are picked through a compare mask
+        __m128i greater = _mm_cmpgt_epi32(a, b);
+        __m128i maxScore = _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+        greater = _mm_cmpgt_epi32(maxScore, c);
+        maxScore = _mm_or_si128(_mm_and_si128(greater, maxScore), _mm_andnot_si128(greater, c));
+
+        __m128i threeMax = _mm_add_epi32(_mm_add_epi32(maxScore, maxScore), maxScore);
+        __m128i distance = _mm_sub_epi32(threeMax, _mm_add_epi32(_mm_add_epi32(a, b), c));
+
+        //most blocks have nothing better than the best so far
+        __m128i better = _mm_cmplt_epi32(distance, _mm_set1_epi32(smallestDistance));
+        if (_mm_movemask_epi8(better) == 0) {
+            continue;
+        }
+        _mm_store_si128(reinterpret_cast<__m128i *>(distances), distance);
+        for (int lane = 0; lane < 4; ++lane) {
+            if (distances[lane] < smallestDistance) {
+                bestIndex = i + lane;
+                smallestDistance = distances[lane];
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        int a = lifeQualityScore + life[i];
+        int b = economyScore + economy[i];
+        int c = environmentScore + environment[i];
+        int maxScore = a > b ? a : b;
+        maxScore = maxScore > c ? maxScore : c;
+        int distance = 3 * maxScore - (a + b + c);
+
+        if (distance < smallestDistance) {
+            bestIndex = i;
+            smallestDistance = distance;
+        }
+    }
+    return bestIndex;
+}
+
+int FacilityCatalog::nextInCategory(FacilityCategory category, size_t from) const {
+    if (facilities.empty()) {
+        return -1;
+    }
+    const vector<int> &next = nextByCategory[static_cast<size_t>(category)];
+    int index = next[from % facilities.size()];
+    return index != -1 ? index : next[0];
+}
+
+bool FacilityCatalog::hasCategory(FacilityCategory category) const {
+    return !facilities.empty() && nextByCategory[static_cast<size_t>(category)][0] != -1;
+}
+
+const int *FacilityCatalog::getLifeQualityScores() const {
+    return lifeQualityScores.data();
+}
+
+const int *FacilityCatalog::getEconomyScores() const {
+    return economyScores.data();
+}
+
+const int *FacilityCatalog::getEnvironmentScores() const {
+    return environmentScores.data();
+}
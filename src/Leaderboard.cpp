@@ -0,0 +1,107 @@
+#include "Leaderboard.h"
+
+Leaderboard::Leaderboard() : rankings(), scores(), ranked(), touched(), pending(), count(0), totals() {}
+
+void Leaderboard::clear() {
+    for (auto &ranking : rankings) {
+        ranking.clear();
+    }
+    scores.clear();
+    ranked.clear();
+    touched.clear();
+    pending.clear();
+    count = 0;
+    for (int64_t &total : totals) {
+        total = 0;
+    }
+}
+
+void Leaderboard::update(size_t slot, const Plan &plan) {
+    int64_t life = plan.getlifeQualityScore();
+    int64_t economy = plan.getEconomyScore();
+    int64_t environment = plan.getEnvironmentScore();
+    int64_t values[SCORE_METRICS] = {life, economy, environment, life + economy + environment};
+
+    if (slot >= scores.size()) {
+        scores.resize(slot + 1);
+        ranked.resize(slot + 1, false);
+        touched.resize(slot + 1, false);
+    }
+    Scores &known = scores[slot];
+    if (ranked[slot]) {
+        if (known.values[0] == values[0] && known.values[1] == values[1] && known.values[2] == values[2]) {
+            return;
+        }
+        for (int metric = 0; metric < SCORE_METRICS; ++metric) {
+            rankings[metric].erase(Entry(-known.values[metric], known.planId));
+            totals[metric] -= known.values[metric];
+        }
+    }
+    else {
+        ranked[slot] = true;
+        count++;
+    }
+
+    known.planId = plan.getId();
+    for (int metric = 0; metric < SCORE_METRICS; ++metric) {
+        known.values[metric] = values[metric];
+        rankings[metric].insert(Entry(-values[metric], known.planId));
+        totals[metric] += values[metric];
+    }
+}
+
+void Leaderboard::touch(size_t slot) {
+    if (slot < touched.size() && !touched[slot]) {
+        touched[slot] = true;
+        pending.push_back(slot);
+    }
+}
+
+void Leaderboard::refresh(const vector<CowPtr<Plan>> &plans) {
+    for (size_t slot : pending) {
+        touched[slot] = false;
+        update(slot, *plans[slot]);
+    }
+    pending.clear();
+}
+
+size_t Leaderboard::size() const {
+    return count;
+}
+
+int64_t Leaderboard::getTotal(ScoreMetric metric) const {
+    return totals[static_cast<int>(metric)];
+}
+
+vector<std::pair<int, int64_t>> Leaderboard::top(ScoreMetric metric, size_t k) const {
+    vector<std::pair<int, int64_t>> best;
+    const auto &ranking = rankings[static_cast<int>(metric)];
+    for (auto entry = ranking.begin(); entry != ranking.end() && best.size() < k; ++entry) {
+        best.push_back(std::make_pair(entry->second, -entry->first));
+    }
+    return best;
+}
+
+bool Leaderboard::parseMetric(const string &name, ScoreMetric &metric) {
+    for (int i = 0; i < SCORE_METRICS; ++i) {
+        if (name == metricName(static_cast<ScoreMetric>(i))) {
+            metric = static_cast<ScoreMetric>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *Leaderboard::metricName(ScoreMetric metric) {
+    switch (metric) {
+        case ScoreMetric::LIFE_QUALITY:
+            return "life";
+        case ScoreMetric::ECONOMY:
+            return "economy";
+        case ScoreMetric::ENVIRONMENT:
+            return "environment";
+        case ScoreMetric::TOTAL:
+            return "total";
+    }
+    return "";
+}
@@ -0,0 +1,106 @@
+#include "Metrics.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+static const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "ticks", "steps", "plan_steps", "facilities_started", "facilities_completed", "backups", "restores",
+    "shared_bytes_copied"
+};
+
+static const char *const TIMER_NAMES[TIMER_COUNT] = {
+    "simulation_step", "plan_steps", "select_naive", "select_balanced", "select_economy", "select_sustainability",
+    "construct", "backup", "restore"
+};
+
+//which counters and timers count work on plans rather than on the whole world
+static const bool COUNTER_PER_PLAN[COUNTER_COUNT] = {
+    false, false, true, true, true, false, false, true
+};
+
+static const bool TIMER_PER_PLAN[TIMER_COUNT] = {
+    false, true, true, true, true, true, false, false, false
+};
+
+//dumped every this many ticks when SIM_METRICS_FILE is set and SIM_METRICS_EVERY is not
+static const uint64_t DEFAULT_DUMP_EVERY = 100;
+
+std::atomic<uint64_t> Metrics::allocations(0);
+
+Metrics &Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() : counters(), timerCounts(), timerNanos(), previous(), lastStep(),
+    dumpPath(), dumpEvery(DEFAULT_DUMP_EVERY), nextDump(DEFAULT_DUMP_EVERY) {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        counters[i].store(0);
+    }
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        timerCounts[i].store(0);
+        timerNanos[i].store(0);
+    }
+
+    const char *path = std::getenv("SIM_METRICS_FILE");
+    if (path != nullptr) {
+        dumpPath = path;
+    }
+    const char *every = std::getenv("SIM_METRICS_EVERY");
+    if (every != nullptr && std::atol(every) > 0) {
+        dumpEvery = static_cast<uint64_t>(std::atol(every));
+        nextDump = dumpEvery;
+    }
+}
+
+void Metrics::endStep() {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        uint64_t now = counters[i].load(std::memory_order_relaxed);
+        lastStep[i] = now - previous[i];
+        previous[i] = now;
+    }
+
+    uint64_t ticks = counters[static_cast<int>(Counter::TICKS)].load(std::memory_order_relaxed);
+    if (dumpPath.empty() || ticks < nextDump) {
+        return;
+    }
+    nextDump = (ticks / dumpEvery + 1) * dumpEvery;
+    std::ofstream file(dumpPath, std::ios::app);
+    if (file.is_open()) {
+        print(file);
+        file << '\n';
+    }
+}
+
+//counters, then each timer as a count and a total in nanoseconds, then the last step's deltas
+bool Metrics::isPerPlan(const string &name) {
+    if (name == "allocations") {
+        return true;
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (name == COUNTER_NAMES[i] || name == string("last_step_") + COUNTER_NAMES[i]) {
+            return COUNTER_PER_PLAN[i];
+        }
+    }
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        if (name == string(TIMER_NAMES[i]) + "_count" || name == string(TIMER_NAMES[i]) + "_ns") {
+            return TIMER_PER_PLAN[i];
+        }
+    }
+    return false;
+}
+
+void Metrics::print(std::ostream &out) const {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        out << COUNTER_NAMES[i] << ' ' << counters[i].load(std::memory_order_relaxed) << '\n';
+    }
+    out << "allocations " << allocations.load(std::memory_order_relaxed) << '\n';
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        out << TIMER_NAMES[i] << "_count " << timerCounts[i].load(std::memory_order_relaxed) << '\n';
+        out << TIMER_NAMES[i] << "_ns " << timerNanos[i].load(std::memory_order_relaxed) << '\n';
+    }
+    for (Counter counter : {Counter::TICKS, Counter::PLAN_STEPS, Counter::FACILITIES_STARTED, Counter::FACILITIES_COMPLETED}) {
+        int i = static_cast<int>(counter);
+        out << "last_step_" << COUNTER_NAMES[i] << ' ' << lastStep[i] << '\n';
+    }
+}
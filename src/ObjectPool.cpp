@@ -0,0 +1,76 @@
+#include "ObjectPool.h"
+#include <cstdlib>
+
+ObjectPool &ObjectPool::instance() {
+    static ObjectPool pool;
+    return pool;
+}
+
+ObjectPool::ObjectPool() : freeLists(), cursor(nullptr), limit(nullptr), chunks(), busy() {
+    busy.clear();
+}
+
+//every pooled object must be gone by now (main deletes the backups before returning)
+ObjectPool::~ObjectPool() {
+    for (void *chunk : chunks) {
+        std::free(chunk);
+    }
+}
+
+void *ObjectPool::allocate(size_t size) {
+    if (size == 0 || size > MAX_BLOCK) {
+        return ::operator new(size);
+    }
+    size_t sizeClass = (size - 1) / GRANULE;
+
+    while (busy.test_and_set(std::memory_order_acquire)) {}
+    void *memory;
+    FreeBlock *block = freeLists[sizeClass];
+    if (block != nullptr) {
+        freeLists[sizeClass] = block->next;
+        memory = block;
+    }
+    else {
+        memory = refill(sizeClass);
+    }
+    busy.clear(std::memory_order_release);
+
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void ObjectPool::deallocate(void *memory, size_t size) {
+    if (memory == nullptr) {
+        return;
+    }
+    if (size == 0 || size > MAX_BLOCK) {
+        ::operator delete(memory);
+        return;
+    }
+    size_t sizeClass = (size - 1) / GRANULE;
+
+    while (busy.test_and_set(std::memory_order_acquire)) {}
+    FreeBlock *block = static_cast<FreeBlock *>(memory);
+    block->next = freeLists[sizeClass];
+    freeLists[sizeClass] = block;
+    busy.clear(std::memory_order_release);
+}
+
+//bumps the cursor, starting a new chunk when the current one can't fit the block
+void *ObjectPool::refill(size_t sizeClass) {
+    size_t blockSize = (sizeClass + 1) * GRANULE;
+    if (static_cast<size_t>(limit - cursor) < blockSize) {
+        char *chunk = static_cast<char *>(std::malloc(CHUNK_SIZE));
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+        chunks.push_back(chunk);
+        cursor = chunk;
+        limit = chunk + CHUNK_SIZE;
+    }
+    void *memory = cursor;
+    cursor += blockSize;
+    return memory;
+}
@@ -1,16 +1,23 @@
 #include "Plan.h"
 #include "Facility.h"
+#include "Checkpoint.h"
+#include "Metrics.h"
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
+
+//Give up on cycle detection (and keep ticking) after this many distinct states
+static const size_t MAX_CYCLE_STATES = 4096;
 
 //Plan constructor
-Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions)
+Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy)
     : plan_id(planId),
       settlement(settlement),
       selectionPolicy(selectionPolicy),
       status(PlanStatus::AVALIABLE),
-      facilities(), underConstruction(),
-      facilityOptions(facilityOptions),
+      facilities(), underConstruction(), underConstructionFinish(), nextTick(0),
       life_quality_score(0),
       economy_score(0),
       environment_score(0){}
@@ -20,16 +27,6 @@ Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *sele
 //Delete:
 Plan::~Plan() {
     delete selectionPolicy;
-
-    for (Facility *facility : facilities) {
-        delete facility;
-    }
-    facilities.clear();
-
-    for (Facility *facility : underConstruction) {
-        delete facility;
-    }
-    underConstruction.clear();
 }
 
 //copy constructor:
@@ -38,21 +35,13 @@ Plan::Plan(const Plan &other)
       settlement(other.settlement),
       selectionPolicy(other.selectionPolicy->clone()),
       status(other.status),
-      facilities(),
-      underConstruction(),
-      facilityOptions(other.facilityOptions),
+      facilities(other.facilities),
+      underConstruction(other.underConstruction),
+      underConstructionFinish(other.underConstructionFinish),
+      nextTick(other.nextTick),
       life_quality_score(other.life_quality_score),
       economy_score(other.economy_score),
-      environment_score(other.environment_score) {
-
-        for (const Facility *facility : other.facilities) {
-            facilities.push_back(new Facility(*facility));
-        }
-
-        for (const Facility *facility : other.underConstruction) {
-            underConstruction.push_back(new Facility(*facility));
-        }
-      }
+      environment_score(other.environment_score) {}
 
 //Move Constractor
 Plan::Plan(Plan &&other) noexcept
@@ -62,7 +51,8 @@ Plan::Plan(Plan &&other) noexcept
       status(other.status),
       facilities(std::move(other.facilities)),
       underConstruction(std::move(other.underConstruction)),
-      facilityOptions(other.facilityOptions),
+      underConstructionFinish(std::move(other.underConstructionFinish)),
+      nextTick(other.nextTick),
       life_quality_score(other.life_quality_score),
       economy_score(other.economy_score),
       environment_score(other.environment_score) {
@@ -100,71 +90,261 @@ int Plan::getId() const {
     return plan_id;
 }
 
-//plan methods
-void Plan::step() {
-    int constructionLimit = getConstructionLimit(settlement); 
+const Settlement &Plan::getSettlement() const {
+    return settlement;
+}
+
+const vector<int> &Plan::getFacilities() const {
+    return facilities;
+}
+
+const vector<int> &Plan::getUnderConstruction() const {
+    return underConstruction;
+}
+
+int64_t Plan::getNextTick() const {
+    return nextTick;
+}
+
+const SelectionPolicy &Plan::getSelectionPolicy() const {
+    return *selectionPolicy;
+}
 
-    while (underConstruction.size() < static_cast<size_t>(constructionLimit)) {
+PlanStatus Plan::getStatus() const {
+    return status;
+}
+
+//what a pick does besides choosing; only the balanced policy keeps running scores
+static inline void afterSelect(SelectionPolicy &, const FacilityType &) {}
+
+static inline void afterSelect(BalancedSelection &policy, const FacilityType &facility) {
+    policy.updateScore(facility);
+}
+
+//Fills the free construction slots. Instantiated once per policy class, and those are
+//final, so every policy call in here is a direct (inlinable) call.
+template <typename Policy>
+void Plan::fillSlots(Policy &policy, const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log, size_t constructionLimit) {
+    while (underConstruction.size() < constructionLimit) {
         try {
             if (facilityOptions.empty()) {
-                std::cerr << "No facilities left for selection" << std::endl;
+                log << "No facilities left for selection" << '\n';
+                break;
+            }
+            //a policy with nothing to pick is reported up front instead of failing inside selectFacility
+            if (!policy.canSelect(facilityOptions)) {
+                log << "Error during facility selection: " << policy.unavailableMessage() << '\n';
                 break;
             }
 
-            const FacilityType& selectedFacilityType = selectionPolicy->selectFacility(facilityOptions);
-            Facility* newFacility = new Facility(selectedFacilityType, settlement.getName());
-            underConstruction.push_back(newFacility);
-            BalancedSelection* b = dynamic_cast<BalancedSelection*> (selectionPolicy);
-            if (b) b->updateScore(selectedFacilityType);
+            const FacilityType& selectedFacilityType = policy.selectFacility(facilityOptions);
+            underConstruction.push_back(facilityOptions.indexOf(selectedFacilityType));
+            //the starting tick counts as the first one of the build
+            underConstructionFinish.push_back(now + std::max(selectedFacilityType.getCost() - 1, 0));
+            afterSelect(policy, selectedFacilityType);
         }
         catch (std::exception& e) {
-            std::cerr << "Error during facility selection: " << e.what() << std::endl;
+            log << "Error during facility selection: " << e.what() << '\n';
             break; 
         }
     }
-        
-    for (auto it = underConstruction.begin(); it != underConstruction.end();) {
-        Facility *facility = *it;
-        facility->step();
+}
+
+//plan methods
+//diagnostics go to the given stream so parallel steps can keep them in plan order
+void Plan::step(const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log) {
+    size_t constructionLimit = getConstructionLimit(settlement);
+    switch (selectionPolicy->getKind()) {
+        case PolicyKind::NAIVE:
+            stepAs<NaiveSelection>(facilityOptions, now, log, constructionLimit);
+            break;
+        case PolicyKind::BALANCED:
+            stepAs<BalancedSelection>(facilityOptions, now, log, constructionLimit);
+            break;
+        case PolicyKind::ECONOMY:
+            stepAs<EconomySelection>(facilityOptions, now, log, constructionLimit);
+            break;
+        case PolicyKind::SUSTAINABILITY:
+            stepAs<SustainabilitySelection>(facilityOptions, now, log, constructionLimit);
+            break;
+    }
+}
+
+template <typename Policy>
+void Plan::stepGroup(Plan *const *plans, size_t count, const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log, size_t constructionLimit) {
+    for (size_t i = 0; i < count; ++i) {
+        plans[i]->stepAs<Policy>(facilityOptions, now, log, constructionLimit);
+    }
+}
+
+//Steps plans that share a policy kind and a settlement type, so the policy class and the
+//construction limit are settled once for all of them instead of once per plan
+void Plan::stepGroup(Plan *const *plans, size_t count, PolicyKind kind,
+                     const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log) {
+    if (count == 0) {
+        return;
+    }
+    size_t constructionLimit = plans[0]->getConstructionLimit(plans[0]->settlement);
+    switch (kind) {
+        case PolicyKind::NAIVE:
+            stepGroup<NaiveSelection>(plans, count, facilityOptions, now, log, constructionLimit);
+            break;
+        case PolicyKind::BALANCED:
+            stepGroup<BalancedSelection>(plans, count, facilityOptions, now, log, constructionLimit);
+            break;
+        case PolicyKind::ECONOMY:
+            stepGroup<EconomySelection>(plans, count, facilityOptions, now, log, constructionLimit);
+            break;
+        case PolicyKind::SUSTAINABILITY:
+            stepGroup<SustainabilitySelection>(plans, count, facilityOptions, now, log, constructionLimit);
+            break;
+    }
+}
 
-        if (facility->getTimeLeft() == 0) {
+//One tick, with the policy's class and the settlement's construction limit already known
+template <typename Policy>
+void Plan::stepAs(const FacilityCatalog &facilityOptions, int64_t now, std::ostream &log, size_t constructionLimit) {
+    METRIC_ONLY(size_t slotsBefore = underConstruction.size();)
+    METRIC_ONLY(size_t builtBefore = facilities.size();)
+
+    fillSlots(static_cast<Policy &>(*selectionPolicy), facilityOptions, now, log, constructionLimit);
+    METRIC_ADD(Counter::FACILITIES_STARTED, underConstruction.size() - slotsBefore);
+        
+    //completing the slots that finish on this tick and compacting the others in place, keeping their order
+    size_t kept = 0;
+    int64_t firstFinish = std::numeric_limits<int64_t>::max();
+    for (size_t i = 0; i < underConstruction.size(); ++i) {
+        if (underConstructionFinish[i] <= now) {
             //moving the facility to operational list
-            facility->setStatus(FacilityStatus::OPERATIONAL);
-            facilities.push_back(facility);
+            const FacilityType &facility = facilityOptions[underConstruction[i]];
+            facilities.push_back(underConstruction[i]);
 
             //updating scores
-            life_quality_score += facility->getLifeQualityScore();
-            economy_score += facility->getEconomyScore();
-            environment_score += facility->getEnvironmentScore();
-
-            it = underConstruction.erase(it);
+            life_quality_score += facility.getLifeQualityScore();
+            economy_score += facility.getEconomyScore();
+            environment_score += facility.getEnvironmentScore();
         }
-
         else {
-            ++it;
+            underConstruction[kept] = underConstruction[i];
+            underConstructionFinish[kept] = underConstructionFinish[i];
+            firstFinish = std::min(firstFinish, underConstructionFinish[i]);
+            kept++;
         }
     }
+    underConstruction.resize(kept);
+    underConstructionFinish.resize(kept);
+    METRIC_ADD(Counter::FACILITIES_COMPLETED, facilities.size() - builtBefore);
 
-    //updating the plan
-    if (underConstruction.size() >= static_cast<size_t>(getConstructionLimit(settlement))) {
+    //updating the plan; a busy plan has nothing to do until a construction completes
+    if (underConstruction.size() >= constructionLimit) {
         status = PlanStatus::BUSY;
+        nextTick = firstFinish;
     }
     else {
         status = PlanStatus::AVALIABLE;
+        nextTick = now + 1;
     }
  }
 
+//A plan is periodic when its policy walks a fixed cycle and never fails to pick,
+//so its whole future is decided by the policy position and the construction slots
+bool Plan::isPeriodic(const FacilityCatalog &facilityOptions) const {
+    return selectionPolicy->getCyclePosition() >= 0 && selectionPolicy->canSelect(facilityOptions);
+}
+
+//finish ticks are taken relative to "now", so the same state seen on different ticks matches
+vector<int> Plan::cycleKey(int64_t now) const {
+    vector<int> key;
+    key.reserve(1 + 2 * underConstruction.size());
+    key.push_back(selectionPolicy->getCyclePosition());
+    key.insert(key.end(), underConstruction.begin(), underConstruction.end());
+    for (int64_t finish : underConstructionFinish) {
+        key.push_back(static_cast<int>(finish - now));
+    }
+    return key;
+}
+
+//Runs the plan forward by the given number of ticks. For periodic plans the state
+//before each tick is remembered; once it repeats, whole cycles are applied at once
+//(their facilities appended and their scores added) and only the remainder is ticked.
+void Plan::advance(const FacilityCatalog &facilityOptions, int64_t now, int ticks, std::ostream &log) {
+    if (ticks < MIN_FAST_FORWARD_TICKS || !isPeriodic(facilityOptions)) {
+        for (int i = 0; i < ticks; ++i) {
+            step(facilityOptions, now + i, log);
+        }
+        return;
+    }
+
+    std::map<vector<int>, int> seenAt; //state -> tick it was seen at
+    vector<size_t> builtAt;            //facilities.size() before each recorded tick
+    vector<int> lifeAt, economyAt, environmentAt;
+    bool searching = true;
+
+    for (int tick = 0; tick < ticks;) {
+        if (searching) {
+            vector<int> key = cycleKey(now + tick);
+            auto found = seenAt.find(key);
+
+            if (found != seenAt.end()) {
+                int start = found->second;
+                int period = tick - start;
+                int cycles = (ticks - tick) / period;
+
+                //replaying the facilities completed during one cycle
+                size_t cycleBegin = builtAt[start];
+                size_t cycleEnd = facilities.size();
+                facilities.reserve(facilities.size() + cycles * (cycleEnd - cycleBegin));
+                for (int c = 0; c < cycles; ++c) {
+                    for (size_t i = cycleBegin; i < cycleEnd; ++i) {
+                        facilities.push_back(facilities[i]);
+                    }
+                }
+
+                life_quality_score += cycles * (life_quality_score - lifeAt[start]);
+                economy_score += cycles * (economy_score - economyAt[start]);
+                environment_score += cycles * (environment_score - environmentAt[start]);
+                for (int64_t &finish : underConstructionFinish) {
+                    finish += static_cast<int64_t>(cycles) * period;
+                }
+                nextTick += static_cast<int64_t>(cycles) * period;
+
+                //in a cycle every slot is refilled as it completes, so as many start as complete
+                METRIC_ADD(Counter::FACILITIES_STARTED, cycles * (cycleEnd - cycleBegin));
+                METRIC_ADD(Counter::FACILITIES_COMPLETED, cycles * (cycleEnd - cycleBegin));
+                tick += cycles * period;
+                searching = false;
+                continue;
+            }
+
+            seenAt.insert(std::make_pair(key, tick));
+            builtAt.push_back(facilities.size());
+            lifeAt.push_back(life_quality_score);
+            economyAt.push_back(economy_score);
+            environmentAt.push_back(environment_score);
+            searching = seenAt.size() < MAX_CYCLE_STATES;
+        }
+
+        step(facilityOptions, now + tick, log);
+        tick++;
+    }
+}
+
  void Plan::setSelectionPolicy(SelectionPolicy *selectionPolicy) {
-    std::cout << "Plan: " << this->plan_id <<std::endl;
-    std::cout << "Current policy: " <<this->selectionPolicy->toString() << std::endl;
+    std::cout << "Plan: " << this->plan_id << '\n';
+    std::cout << "Current policy: " <<this->selectionPolicy->toString() << '\n';
     delete this->selectionPolicy;
     this->selectionPolicy = selectionPolicy;
-    std::cout << "Updated to: " <<this->selectionPolicy->toString() << std::endl;
+    std::cout << "Updated to: " <<this->selectionPolicy->toString() << '\n';
  }
 
-const string Plan::toString() const {
+const string Plan::toString(const FacilityCatalog &facilityOptions, int64_t now) const {
     std::ostringstream oss;
+    print(oss, facilityOptions, now);
+    return oss.str();
+}
 
+//facility lines are written from the stored indices, without building Facility objects
+void Plan::print(std::ostream &oss, const FacilityCatalog &facilityOptions, int64_t now) const {
     oss << "PlanID: " << plan_id << "\n";
     oss << "SettlementName: " << settlement.getName() << "\n";
     oss << "PlanStatus: " << (status == PlanStatus::AVALIABLE ? "Available" : "Busy") << "\n";
@@ -174,16 +354,18 @@ const string Plan::toString() const {
     oss << "EnvironmentScore: " << environment_score << "\n";
 
     oss << "Operational Facilities:\n";
-    for (const auto &Facility : facilities) {
-        oss << " - " << Facility->toString() << "\n";
+    for (int type : facilities) {
+        oss << " - ";
+        Facility::describe(oss, facilityOptions[type].getName(), settlement.getName(), FacilityStatus::OPERATIONAL, 0);
+        oss << "\n";
     }
 
     oss << "Under Constructions facilities:\n";
-    for (const auto &Facility : underConstruction) {
-        oss << " - " << Facility->toString() << "\n";
+    for (size_t i = 0; i < underConstruction.size(); ++i) {
+        oss << " - ";
+        Facility::describe(oss, facilityOptions[underConstruction[i]].getName(), settlement.getName(), FacilityStatus::UNDER_CONSTRUCTIONS, static_cast<int>(underConstructionFinish[i] - now + 1));
+        oss << "\n";
     }
-
-    return oss.str();
 }
 
 const string Plan::resultPrint() const {
@@ -211,13 +393,82 @@ bool Plan::isSamePolicy(const SelectionPolicy *policy) const {
 
 void Plan::printStatus() {
     if (status == PlanStatus::AVALIABLE) {
-        std::cout << "Status: Available" << std::endl;
+        std::cout << "Status: Available" << '\n';
     }
     else {
-        std::cout << "Status: Busy" << std::endl;
+        std::cout << "Status: Busy" << '\n';
+    }
+}
+
+//Checkpoint - the settlement is written by the simulation, which also resolves it on load.
+//Construction slots are stored with their time left, so the file does not depend on the tick count.
+void Plan::save(CheckpointWriter &writer, int64_t now) const {
+    writer.writeInt(plan_id);
+    writer.writeInt(static_cast<int>(status));
+    selectionPolicy->save(writer);
+    writer.writeInt(life_quality_score);
+    writer.writeInt(economy_score);
+    writer.writeInt(environment_score);
+
+    writer.writeInt(static_cast<int>(facilities.size()));
+    for (int type : facilities) {
+        writer.writeInt(type);
+    }
+    writer.writeInt(static_cast<int>(underConstruction.size()));
+    for (size_t i = 0; i < underConstruction.size(); ++i) {
+        writer.writeInt(underConstruction[i]);
+        writer.writeInt(static_cast<int>(underConstructionFinish[i] - now + 1));
+    }
+}
+
+//Facility types must be in the catalog, and a construction can't have more time left than
+//its type takes to build; anything else means the file was damaged or edited
+static int readFacilityType(CheckpointReader &reader, const FacilityCatalog &facilityOptions) {
+    int type = reader.readInt();
+    if (type < 0 || static_cast<size_t>(type) >= facilityOptions.size()) {
+        throw std::runtime_error("Error: Checkpoint file is corrupt");
+    }
+    return type;
+}
+
+Plan *Plan::load(CheckpointReader &reader, const Settlement &settlement, const FacilityCatalog &facilityOptions, int64_t now) {
+    int planId = reader.readInt();
+    int status = reader.readInt();
+    Plan *plan = new Plan(planId, settlement, SelectionPolicy::load(reader, facilityOptions));
+
+    try {
+        plan->status = status == static_cast<int>(PlanStatus::BUSY) ? PlanStatus::BUSY : PlanStatus::AVALIABLE;
+        plan->life_quality_score = reader.readInt();
+        plan->economy_score = reader.readInt();
+        plan->environment_score = reader.readInt();
+
+        int built = reader.readInt();
+        for (int i = 0; i < built; ++i) {
+            plan->facilities.push_back(readFacilityType(reader, facilityOptions));
+        }
+        int building = reader.readInt();
+        for (int i = 0; i < building; ++i) {
+            int type = readFacilityType(reader, facilityOptions);
+            int timeLeft = reader.readInt();
+            if (timeLeft < 1 || timeLeft > std::max(facilityOptions[type].getCost(), 1)) {
+                throw std::runtime_error("Error: Checkpoint file is corrupt");
+            }
+            plan->underConstruction.push_back(type);
+            plan->underConstructionFinish.push_back(now + timeLeft - 1);
+        }
+        //as after a step; a settlement of unknown type has no slots, so nothing is ever due
+        if (static_cast<int>(plan->underConstruction.size()) >= plan->getConstructionLimit(settlement)) {
+            plan->nextTick = plan->underConstructionFinish.empty() ? std::numeric_limits<int64_t>::max() :
+                             *std::min_element(plan->underConstructionFinish.begin(), plan->underConstructionFinish.end());
+        }
+    }
+    catch (...) {
+        delete plan;
+        throw;
     }
+    return plan;
 }
 
-void Plan::addFacility(Facility *facility) {
-    facilities.push_back(facility);
+size_t Plan::getHeapBytes() const {
+    return (facilities.capacity() + underConstruction.capacity()) * sizeof(int) + underConstructionFinish.capacity() * sizeof(int64_t);
 }
@@ -1,32 +1,87 @@
 #include "SelectionPolicy.h"
 #include "Plan.h"
+#include "Checkpoint.h"
+#include "Metrics.h"
 #include <iostream>
 #include <stdexcept>
-#include <climits>
-#include <algorithm>
 
 //helper function
-void SelectionPolicy::markFacilityAsSelected(const FacilityType& facility) {
-    selectedFacility.push_back(facility);
+void SelectionPolicy::markFacilityAsSelected(int facilityIndex) {
+    if (static_cast<size_t>(facilityIndex) >= selectedCount.size()) {
+        selectedCount.resize(facilityIndex + 1, 0);
+    }
+    selectedCount[facilityIndex]++;
 }
 
-bool SelectionPolicy::isFacilitySelected(const FacilityType& facility) {
+bool SelectionPolicy::isFacilitySelected(int facilityIndex) const {
+    return static_cast<size_t>(facilityIndex) < selectedCount.size() && selectedCount[facilityIndex] > 0;
+}
 
-    for (const auto& selected : selectedFacility) {
-        if (selected == facility) {
-            return true;
-        }
+//round-robin positions and selection counts are never negative
+static int readPosition(CheckpointReader &reader) {
+    int position = reader.readInt();
+    if (position < 0) {
+        throw std::runtime_error("Error: Checkpoint file is corrupt");
     }
+    return position;
+}
 
-    return false;
+//Checkpoint - the policy name, the selection counts, then the policy's own state
+void SelectionPolicy::save(CheckpointWriter &writer) const {
+    writer.writeString(toString());
+    writer.writeInt(static_cast<int>(selectedCount.size()));
+    for (int count : selectedCount) {
+        writer.writeInt(count);
+    }
+    saveState(writer);
 }
 
+//A policy's counts and cycle position index the facility options, so they must fit the catalog
+SelectionPolicy *SelectionPolicy::load(CheckpointReader &reader, const FacilityCatalog &facilitiesOptions) {
+    string name = reader.readString();
+    SelectionPolicy *policy = nullptr;
+    if (name == "NaiveSelection") {
+        policy = new NaiveSelection();
+    }
+    else if (name == "BalancedSelection") {
+        policy = new BalancedSelection(0, 0, 0);
+    }
+    else if (name == "EconomySelection") {
+        policy = new EconomySelection();
+    }
+    else if (name == "SustainabilitySelection") {
+        policy = new SustainabilitySelection();
+    }
+    else {
+        throw std::runtime_error("Error: Unknown selection policy in checkpoint: " + name);
+    }
 
+    try {
+        int history = reader.readInt();
+        if (history < 0 || static_cast<size_t>(history) > facilitiesOptions.size()) {
+            throw std::runtime_error("Error: Checkpoint file is corrupt");
+        }
+        for (int i = 0; i < history; ++i) {
+            policy->selectedCount.push_back(readPosition(reader));
+        }
+        policy->loadState(reader);
+        int position = policy->getCyclePosition();
+        if (position > 0 && static_cast<size_t>(position) >= facilitiesOptions.size()) {
+            throw std::runtime_error("Error: Checkpoint file is corrupt");
+        }
+    }
+    catch (...) {
+        delete policy;
+        throw;
+    }
+    return policy;
+}
 
 //Naive selection
-NaiveSelection::NaiveSelection() : lastSelectedIndex(0) {}
+NaiveSelection::NaiveSelection() : SelectionPolicy(PolicyKind::NAIVE), lastSelectedIndex(0) {}
 
-const FacilityType &NaiveSelection::selectFacility(const vector<FacilityType> &facilitiesOptions) {
+const FacilityType &NaiveSelection::selectFacility(const FacilityCatalog &facilitiesOptions) {
+    METRIC_TIME(Timer::SELECT_NAIVE);
 
     if (facilitiesOptions.empty()) {
         throw std::runtime_error("Error: No facilities available for selection");
@@ -45,50 +100,44 @@ NaiveSelection *NaiveSelection::clone() const {
     return new NaiveSelection(*this);
 }
 
-//Balanced selection
-BalancedSelection::BalancedSelection(int lifeQualityScore, int economyScore, int environmentScore)
-    : LifeQualityScore(lifeQualityScore), EconomyScore(economyScore), EnvironmentScore(environmentScore) {}
-
-const FacilityType &BalancedSelection::selectFacility(const vector<FacilityType> &facilitiesOptions) {
-
-    if (facilitiesOptions.empty()) {
-        throw std::runtime_error("Error: No facilities available for selection");
-    }
-
-    int bestIndex = -1;
-    int smallestDistance = INT_MAX;
+int NaiveSelection::getCyclePosition() const {
+    return lastSelectedIndex;
+}
 
-    for (size_t i=0; i < facilitiesOptions.size(); ++i) {
+bool NaiveSelection::canSelect(const FacilityCatalog &facilitiesOptions) const {
+    return !facilitiesOptions.empty();
+}
 
-        if (facilitiesOptions.empty()) {
-            throw std::runtime_error("Error: No facilities available for selection.");
-        }
+const string NaiveSelection::unavailableMessage() const {
+    return "Error: No facilities available for selection";
+}
 
-        const FacilityType &facility = facilitiesOptions[i];
+void NaiveSelection::saveState(CheckpointWriter &writer) const {
+    writer.writeInt(lastSelectedIndex);
+}
 
-        int newLifeQualityScore = LifeQualityScore + facility.getLifeQualityScore();
-        int newEconomyScore = EconomyScore + facility.getEconomyScore();
-        int newEnvironmentScore = EnvironmentScore + facility.getEnvironmentScore();
+void NaiveSelection::loadState(CheckpointReader &reader) {
+    lastSelectedIndex = readPosition(reader);
+}
 
-        std::vector<int> scores = {newLifeQualityScore, newEconomyScore, newEnvironmentScore};
-        int maxScore = *std::max_element(scores.begin(), scores.end());
-        int distance = 0;
-        for (auto col : scores) {
-            distance += maxScore - col;
-        }
+//Balanced selection
+BalancedSelection::BalancedSelection(int lifeQualityScore, int economyScore, int environmentScore)
+    : SelectionPolicy(PolicyKind::BALANCED), LifeQualityScore(lifeQualityScore), EconomyScore(economyScore), EnvironmentScore(environmentScore) {}
 
-        if (distance < smallestDistance) {
-            bestIndex = i;
-            smallestDistance = distance;
-        }
+const FacilityType &BalancedSelection::selectFacility(const FacilityCatalog &facilitiesOptions) {
+    METRIC_TIME(Timer::SELECT_BALANCED);
 
+    if (facilitiesOptions.empty()) {
+        throw std::runtime_error("Error: No facilities available for selection");
     }
 
+    int bestIndex = facilitiesOptions.findMostBalanced(LifeQualityScore, EconomyScore, EnvironmentScore);
+
     //checking we got a facility to give
     if (bestIndex == -1) {
         throw std::runtime_error("Error: Cannot select facility");
     }
-    markFacilityAsSelected(facilitiesOptions[bestIndex]);
+    markFacilityAsSelected(bestIndex);
     return facilitiesOptions[bestIndex];
 }
 
@@ -97,7 +146,32 @@ const string BalancedSelection::toString() const {
 }
 
 BalancedSelection *BalancedSelection::clone() const {
-    return new BalancedSelection(LifeQualityScore, EconomyScore, EnvironmentScore);
+    return new BalancedSelection(*this);
+}
+
+//balanced picks depend on the running scores, so there is no fixed cycle
+int BalancedSelection::getCyclePosition() const {
+    return -1;
+}
+
+bool BalancedSelection::canSelect(const FacilityCatalog &facilitiesOptions) const {
+    return !facilitiesOptions.empty();
+}
+
+const string BalancedSelection::unavailableMessage() const {
+    return "Error: No facilities available for selection";
+}
+
+void BalancedSelection::saveState(CheckpointWriter &writer) const {
+    writer.writeInt(LifeQualityScore);
+    writer.writeInt(EconomyScore);
+    writer.writeInt(EnvironmentScore);
+}
+
+void BalancedSelection::loadState(CheckpointReader &reader) {
+    LifeQualityScore = reader.readInt();
+    EconomyScore = reader.readInt();
+    EnvironmentScore = reader.readInt();
 }
 
 void BalancedSelection::updateScore(const FacilityType& facility) {
@@ -107,28 +181,22 @@ void BalancedSelection::updateScore(const FacilityType& facility) {
 }
 
 //Economy selection
-EconomySelection::EconomySelection() : lastSelectedIndex(0) {}
+EconomySelection::EconomySelection() : SelectionPolicy(PolicyKind::ECONOMY), lastSelectedIndex(0) {}
 
-const FacilityType &EconomySelection::selectFacility(const vector<FacilityType> &facilitiesOptions) {
+//the next economy facility after the last pick, in the same round-robin order as a scan
+const FacilityType &EconomySelection::selectFacility(const FacilityCatalog &facilitiesOptions) {
+    METRIC_TIME(Timer::SELECT_ECONOMY);
 
     if (facilitiesOptions.empty()) {
         throw std::runtime_error("Error: no facilities available for selection.");
     }
 
-    size_t numFacilities = facilitiesOptions.size();
-    size_t startIndex = lastSelectedIndex;
-
-    for (size_t i=0; i<facilitiesOptions.size(); ++i) {
-        size_t currentIndex = (startIndex + i) % numFacilities;
-        const FacilityType &facility = facilitiesOptions[currentIndex];
-
-        if (facility.getCategory() == FacilityCategory::ECONOMY) {
-            lastSelectedIndex = (currentIndex + 1) % numFacilities;
-            return facility;
-        }
+    int index = facilitiesOptions.nextInCategory(FacilityCategory::ECONOMY, lastSelectedIndex);
+    if (index == -1) {
+        throw std::runtime_error(unavailableMessage());
     }
-
-    throw std::runtime_error("Error: No facilities in the Economy category available.");
+    lastSelectedIndex = (index + 1) % facilitiesOptions.size();
+    return facilitiesOptions[index];
 }
 
 const string EconomySelection::toString() const {
@@ -136,32 +204,46 @@ const string EconomySelection::toString() const {
 }
 
 EconomySelection *EconomySelection::clone() const {
-    return new EconomySelection();
+    return new EconomySelection(*this);
+}
+
+int EconomySelection::getCyclePosition() const {
+    return lastSelectedIndex;
+}
+
+bool EconomySelection::canSelect(const FacilityCatalog &facilitiesOptions) const {
+    return facilitiesOptions.hasCategory(FacilityCategory::ECONOMY);
+}
+
+const string EconomySelection::unavailableMessage() const {
+    return "Error: No facilities in the Economy category available.";
+}
+
+void EconomySelection::saveState(CheckpointWriter &writer) const {
+    writer.writeInt(lastSelectedIndex);
+}
+
+void EconomySelection::loadState(CheckpointReader &reader) {
+    lastSelectedIndex = readPosition(reader);
 }
 
 //Sustainablity selection
-SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(0) {}
+SustainabilitySelection::SustainabilitySelection() : SelectionPolicy(PolicyKind::SUSTAINABILITY), lastSelectedIndex(0) {}
+
+//the next environment facility after the last pick, in the same round-robin order as a scan
+const FacilityType &SustainabilitySelection::selectFacility(const FacilityCatalog &facilitiesOptions) {
+    METRIC_TIME(Timer::SELECT_SUSTAINABILITY);
 
-const FacilityType &SustainabilitySelection::selectFacility(const vector<FacilityType> &facilitiesOptions) {
-    
     if (facilitiesOptions.empty()) {
         throw std::runtime_error("Error: no facilities available for selection.");
     }
 
-    size_t numFacilities = facilitiesOptions.size();
-    size_t startIndex = lastSelectedIndex;
-
-    for (size_t i=0; i<facilitiesOptions.size(); ++i) {
-        size_t currentIndex = (startIndex + i) % numFacilities;
-        const FacilityType &facility = facilitiesOptions[currentIndex];
-
-        if (facility.getCategory() == FacilityCategory::ENVIRONMENT) {
-            lastSelectedIndex = (currentIndex + 1) % numFacilities;
-            return facility;
-        }
+    int index = facilitiesOptions.nextInCategory(FacilityCategory::ENVIRONMENT, lastSelectedIndex);
+    if (index == -1) {
+        throw std::runtime_error(unavailableMessage());
     }
-
-    throw std::runtime_error("Error: No facilities in the Environment category available.");
+    lastSelectedIndex = (index + 1) % facilitiesOptions.size();
+    return facilitiesOptions[index];
 }
 
 const string SustainabilitySelection::toString() const {
@@ -169,6 +251,26 @@ const string SustainabilitySelection::toString() const {
 }
 
 SustainabilitySelection *SustainabilitySelection::clone() const {
-    return new SustainabilitySelection();
+    return new SustainabilitySelection(*this);
+}
+
+int SustainabilitySelection::getCyclePosition() const {
+    return lastSelectedIndex;
+}
+
+bool SustainabilitySelection::canSelect(const FacilityCatalog &facilitiesOptions) const {
+    return facilitiesOptions.hasCategory(FacilityCategory::ENVIRONMENT);
+}
+
+const string SustainabilitySelection::unavailableMessage() const {
+    return "Error: No facilities in the Environment category available.";
+}
+
+void SustainabilitySelection::saveState(CheckpointWriter &writer) const {
+    writer.writeInt(lastSelectedIndex);
+}
+
+void SustainabilitySelection::loadState(CheckpointReader &reader) {
+    lastSelectedIndex = readPosition(reader);
 }
 
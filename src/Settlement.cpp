@@ -2,14 +2,18 @@
 using std::string;
 
 //Constructor
-Settlement::Settlement(const string &name, SettlementType type)
+Settlement::Settlement(Symbol name, SettlementType type)
     :name(name), type(type){}
 
 Settlement::Settlement(const Settlement &settlement)
-    : name(settlement.getName()), type(settlement.getType()) {}
+    : name(settlement.name), type(settlement.getType()) {}
 
 //Getter's
 const string &Settlement::getName() const {
+    return name.str();
+}
+
+Symbol Settlement::getSymbol() const {
     return name;
 }
 
@@ -30,7 +34,7 @@ const string Settlement::toString() const {
             stringType = "Metropolis";
             break;
     }
-    return "Settlement " + name + " is a " + stringType;
+    return "Settlement " + name.str() + " is a " + stringType;
 }
 
 
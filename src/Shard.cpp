@@ -0,0 +1,580 @@
+#include "Shard.h"
+#include "Action.h"
+#include "Auxiliary.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//In batch mode a run of plain steps goes to the shards as one request of at most this many lines
+static const size_t MAX_STEP_RUN = 1024;
+
+//Message - integers little-endian, as in checkpoints
+ShardMessage::ShardMessage() : buffer(), offset(0) {}
+
+void ShardMessage::writeInt(int value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+}
+
+void ShardMessage::writeString(const string &value) {
+    writeInt(static_cast<int>(value.size()));
+    buffer.append(value);
+}
+
+void ShardMessage::writeInt64(int64_t value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    writeInt(static_cast<int>(bits & 0xffffffffu));
+    writeInt(static_cast<int>(bits >> 32));
+}
+
+void ShardMessage::need(size_t bytes) const {
+    if (buffer.size() - offset < bytes) {
+        throw std::runtime_error("Error: Shard message is truncated");
+    }
+}
+
+int ShardMessage::readInt() {
+    need(4);
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+        bits |= static_cast<uint32_t>(static_cast<unsigned char>(buffer[offset + i])) << (8 * i);
+    }
+    offset += 4;
+    return static_cast<int>(bits);
+}
+
+string ShardMessage::readString() {
+    int length = readInt();
+    if (length < 0) {
+        throw std::runtime_error("Error: Shard message is corrupt");
+    }
+    need(length);
+    string value = buffer.substr(offset, length);
+    offset += length;
+    return value;
+}
+
+int64_t ShardMessage::readInt64() {
+    uint64_t low = static_cast<uint32_t>(readInt());
+    uint64_t high = static_cast<uint32_t>(readInt());
+    return static_cast<int64_t>(low | (high << 32));
+}
+
+bool ShardMessage::atEnd() const {
+    return offset == buffer.size();
+}
+
+void ShardMessage::assign(const string &bytes) {
+    buffer = bytes;
+    offset = 0;
+}
+
+const string &ShardMessage::bytes() const {
+    return buffer;
+}
+
+//MSG_NOSIGNAL: a worker that died is reported as an error instead of killing the coordinator
+void ShardMessage::send(int fd) const {
+    uint32_t size = static_cast<uint32_t>(buffer.size());
+    char header[4];
+    for (int i = 0; i < 4; ++i) {
+        header[i] = static_cast<char>((size >> (8 * i)) & 0xff);
+    }
+    string frame(header, sizeof(header));
+    frame.append(buffer);
+
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t written = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            throw std::runtime_error("Error: Lost the connection to a shard");
+        }
+        sent += written;
+    }
+}
+
+//reads exactly size bytes; false if the stream ends first
+static bool readFully(int fd, char *data, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t count = ::read(fd, data + got, size - got);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        got += count;
+    }
+    return true;
+}
+
+bool ShardMessage::receive(int fd) {
+    unsigned char header[4];
+    if (!readFully(fd, reinterpret_cast<char *>(header), sizeof(header))) {
+        return false;
+    }
+    uint32_t size = 0;
+    for (int i = 0; i < 4; ++i) {
+        size |= static_cast<uint32_t>(header[i]) << (8 * i);
+    }
+    buffer.assign(size, '\0');
+    offset = 0;
+    if (size > 0 && !readFully(fd, &buffer[0], size)) {
+        throw std::runtime_error("Error: Shard message is truncated");
+    }
+    return true;
+}
+
+//Constructor - each worker gets one end of its own socket pair and never returns from serve
+ShardCoordinator::ShardCoordinator(const string &configFilePath, int shardCount) : sockets(), workers(), owners() {
+    std::cout.flush();
+    std::cerr.flush();
+    for (int shard = 0; shard < shardCount; ++shard) {
+        int pair[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            throw std::runtime_error("Error: Can't create a shard socket");
+        }
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            ::close(pair[0]);
+            ::close(pair[1]);
+            throw std::runtime_error("Error: Can't start a shard process");
+        }
+        if (pid == 0) {
+            for (int fd : sockets) {
+                ::close(fd);
+            }
+            ::close(pair[0]);
+            int status = 0;
+            try {
+                serve(pair[1], configFilePath, shard, shardCount);
+            }
+            catch (...) {
+                status = 1;
+            }
+            ::_exit(status); //the parent's buffers and snapshots are not this process's to flush or free
+        }
+        ::close(pair[1]);
+        sockets.push_back(pair[0]);
+        workers.push_back(pid);
+    }
+
+    //each worker answers first with what loading the config printed and the plans it kept
+    vector<Reply> replies(sockets.size());
+    for (size_t shard = 0; shard < sockets.size(); ++shard) {
+        receive(shard, replies[shard]);
+    }
+    std::cout << replies[0].out;
+    std::cerr << replies[0].err;
+}
+
+ShardCoordinator::~ShardCoordinator() {
+    for (size_t shard = 0; shard < sockets.size(); ++shard) {
+        try {
+            send(shard, Request::STOP, "");
+        }
+        catch (const std::exception &) {
+            //already gone
+        }
+        ::close(sockets[shard]);
+    }
+    for (pid_t pid : workers) {
+        int status;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+}
+
+//step with a plain tick count: prints nothing but the diagnostics of the plans it steps
+static bool isPlainStep(const string &inputLine) {
+    vector<string> args = Auxiliary::parseArguments(inputLine);
+    if (args.size() != 2 || args[0] != "step" || args[1].size() > 9) {
+        return false;
+    }
+    return std::all_of(args[1].begin(), args[1].end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+//Without prompts the shards can be sent a run of steps at once, which saves a round trip per
+//step; their diagnostics still come back tagged with tick and plan, so the output is the same.
+void ShardCoordinator::start(bool batch) {
+    std::cout << "The simulation has started" << '\n';
+    std::string inputLine;
+    bool pending = false; //inputLine was read ahead and not run yet
+    while (true) {
+        if (!batch) {
+            std::cout << "Enter an action: ";
+        }
+        if (!pending && !std::getline(std::cin, inputLine)) {
+            break; //end of input
+        }
+        pending = false;
+
+        if (batch && isPlainStep(inputLine)) {
+            string steps = inputLine;
+            //only lines already read in are taken, so a live pipe never waits on the next line
+            for (size_t count = 1; count < MAX_STEP_RUN && std::cin.rdbuf()->in_avail() > 0 &&
+                                   std::getline(std::cin, inputLine); ++count) {
+                if (!isPlainStep(inputLine)) {
+                    pending = true;
+                    break;
+                }
+                steps += '\n' + inputLine;
+            }
+            vector<Reply> replies;
+            broadcast(Request::COMMANDS, steps, replies);
+            printMerged(replies);
+            continue;
+        }
+        if (!runCommand(inputLine)) {
+            break;
+        }
+    }
+}
+
+//A worker runs Simulation::runCommand on its own shard. Its output is collected instead of
+//printed, and a journal, a log spill file or a metrics dump is only written by shard 0,
+//which sees every action in order. Each shard publishes its plans to a shared view of its
+//own, named after the configured one with "-<shard>" appended. The shards already run side
+//by side, so each one steps its plans on its own thread instead of starting a thread pool.
+void ShardCoordinator::serve(int fd, const string &configFilePath, int shard, int shardCount) {
+    if (shard != 0) {
+        ::unsetenv("SIM_COMMAND_JOURNAL");
+        ::unsetenv("SIM_LOG_JOURNAL");
+        ::unsetenv("SIM_METRICS_FILE");
+    }
+    ::setenv("SIM_THREADS", "1", 1);
+    const char *view = std::getenv("SIM_SHARED_VIEW");
+    if (view != nullptr && *view) {
+        ::setenv("SIM_SHARED_VIEW", (string(view) + "-" + std::to_string(shard)).c_str(), 1);
+    }
+    std::ostringstream out;
+    std::ostringstream err;
+    std::cout.rdbuf(out.rdbuf());
+    std::cerr.rdbuf(err.rdbuf());
+
+    Simulation simulation(configFilePath, shard, shardCount);
+    vector<PlanDiagnostic> diagnostics;
+    ShardMessage logged;
+    simulation.collectDiagnostics(&diagnostics);
+    simulation.setActionObserver(&logged);
+    size_t reported = 0;    //plans whose ids the coordinator has been sent
+    bool resend = true;     //the plans may have been replaced, so every id goes out again
+
+    ShardMessage message;
+    while (true) {
+        const vector<CowPtr<Plan>> &plans = simulation.getPlans();
+        message.assign("");
+        message.writeString(out.str());
+        message.writeString(err.str());
+        message.writeInt(static_cast<int>(diagnostics.size()));
+        for (const PlanDiagnostic &diagnostic : diagnostics) {
+            message.writeInt64(diagnostic.tick);
+            message.writeInt(diagnostic.planId);
+            message.writeString(diagnostic.text);
+        }
+        //otherwise plans are only ever appended, so anything past the last count is new
+        resend = resend || plans.size() < reported;
+        size_t first = resend ? 0 : reported;
+        message.writeInt(resend ? 1 : 0);
+        message.writeInt(static_cast<int>(plans.size() - first));
+        for (size_t slot = first; slot < plans.size(); ++slot) {
+            message.writeInt(plans[slot]->getId());
+        }
+        reported = plans.size();
+        resend = false;
+        message.writeString(logged.bytes());
+        message.send(fd);
+
+        out.str("");
+        err.str("");
+        diagnostics.clear();
+        logged.assign("");
+
+        if (!message.receive(fd)) {
+            return;
+        }
+        Request request = static_cast<Request>(message.readInt());
+        string argument = message.readString();
+        if (request == Request::STOP) {
+            return;
+        }
+        if (request == Request::COMMAND) {
+            vector<string> args = Auxiliary::parseArguments(argument);
+            resend = !args.empty() && (args[0] == "restore" || args[0] == "load" || args[0] == "replay");
+            simulation.runCommand(argument);
+        }
+        else if (request == Request::COMMANDS) {
+            std::istringstream lines(argument);
+            string line;
+            while (std::getline(lines, line)) {
+                simulation.runCommand(line);
+            }
+        }
+        else {
+            //actions another shard ran on its own plans, so this shard's log stays complete
+            ShardMessage record;
+            record.assign(argument);
+            while (!record.atEnd()) {
+                std::unique_ptr<BaseAction> action(BaseAction::load(record));
+                simulation.addAction(action.get());
+            }
+        }
+    }
+}
+
+void ShardCoordinator::send(size_t shard, Request request, const string &argument) {
+    ShardMessage message;
+    message.writeInt(static_cast<int>(request));
+    message.writeString(argument);
+    message.send(sockets[shard]);
+}
+
+void ShardCoordinator::receive(size_t shard, Reply &reply) {
+    ShardMessage message;
+    if (!message.receive(sockets[shard])) {
+        throw std::runtime_error("Error: Shard " + std::to_string(shard) + " stopped");
+    }
+    reply.out = message.readString();
+    reply.err = message.readString();
+    int count = message.readInt();
+    reply.diagnostics.clear();
+    for (int i = 0; i < count; ++i) {
+        int64_t tick = message.readInt64();
+        int planId = message.readInt();
+        reply.diagnostics.push_back(PlanDiagnostic{tick, planId, message.readString()});
+    }
+    reply.allPlans = message.readInt() != 0;
+    if (reply.allPlans) {
+        for (auto owner = owners.begin(); owner != owners.end();) {
+            owner = owner->second == shard ? owners.erase(owner) : std::next(owner);
+        }
+    }
+    count = message.readInt();
+    reply.newPlans.clear();
+    for (int i = 0; i < count; ++i) {
+        reply.newPlans.push_back(message.readInt());
+        owners[reply.newPlans.back()] = shard;
+    }
+    reply.logged = message.readString();
+}
+
+//every shard works on the command at the same time
+void ShardCoordinator::broadcast(Request request, const string &argument, vector<Reply> &replies) {
+    for (size_t shard = 0; shard < sockets.size(); ++shard) {
+        send(shard, request, argument);
+    }
+    replies.assign(sockets.size(), Reply());
+    for (size_t shard = 0; shard < sockets.size(); ++shard) {
+        receive(shard, replies[shard]);
+    }
+}
+
+//a plan id no shard reported is sent to shard 0, which fails on it like a single process would
+size_t ShardCoordinator::ownerOf(const string &planId) const {
+    try {
+        auto found = owners.find(std::stoi(planId));
+        if (found != owners.end()) {
+            return found->second;
+        }
+    }
+    catch (const std::exception &) {
+        //not a number
+    }
+    return 0;
+}
+
+//Commands about one plan only go to its shard; whatever it logged is copied into shard 0's
+//log. Everything else goes to every shard: commands that change the world keep all of them
+//alike, and those that print plans have their output merged in plan id order.
+bool ShardCoordinator::runCommand(const string &inputLine) {
+    vector<string> args = Auxiliary::parseArguments(inputLine);
+    if (!args.empty() && args[0] == "#") {
+        return true;
+    }
+    if (!args.empty() && (args[0] == "save" || args[0] == "load" || args[0] == "replay")) {
+        std::cerr << "Error: " << args[0] << " is not supported with shards" << '\n';
+        return true;
+    }
+
+    if (args.size() >= 2 && (args[0] == "planStatus" || args[0] == "changePolicy")) {
+        size_t owner = ownerOf(args[1]);
+        Reply reply;
+        send(owner, Request::COMMAND, inputLine);
+        receive(owner, reply);
+        std::cout << reply.out;
+        std::cerr << reply.err;
+        if (owner != 0 && !reply.logged.empty()) {
+            Reply recorded;
+            send(0, Request::RECORD, reply.logged);
+            receive(0, recorded);
+        }
+        return true;
+    }
+
+    vector<Reply> replies;
+    broadcast(Request::COMMAND, inputLine, replies);
+    if (args.empty()) {
+        printMerged(replies);
+    }
+    else if (args[0] == "close") {
+        printClosed(replies);
+        return false;
+    }
+    else if (args[0] == "top" && replies[0].err.empty() && !replies[0].out.empty()) {
+        printTop(replies, std::stoul(args[2]));
+    }
+    else if (args[0] == "world") {
+        printSums(replies, [](const string &) { return true; });
+    }
+    else if (args[0] == "stats") {
+        printSums(replies, &Metrics::isPerPlan);
+    }
+    else {
+        printMerged(replies);
+    }
+    return true;
+}
+
+//Every shard printed the same thing, except for the diagnostics of its own plans
+void ShardCoordinator::printMerged(const vector<Reply> &replies) {
+    std::cout << replies[0].out;
+    std::cerr << replies[0].err;
+
+    vector<const PlanDiagnostic *> diagnostics;
+    for (const Reply &reply : replies) {
+        for (const PlanDiagnostic &diagnostic : reply.diagnostics) {
+            diagnostics.push_back(&diagnostic);
+        }
+    }
+    std::stable_sort(diagnostics.begin(), diagnostics.end(), [](const PlanDiagnostic *a, const PlanDiagnostic *b) {
+        return a->tick != b->tick ? a->tick < b->tick : a->planId < b->planId;
+    });
+    for (const PlanDiagnostic *diagnostic : diagnostics) {
+        std::cerr << diagnostic->text;
+    }
+}
+
+static bool startsWith(const string &line, const string &prefix) {
+    return line.compare(0, prefix.size(), prefix) == 0;
+}
+
+//Each shard printed the results header and then its plans, one block per plan starting
+//with its PlanID line; the blocks are put back in plan id order under one header.
+void ShardCoordinator::printClosed(const vector<Reply> &replies) {
+    const string planLine = "PlanID: ";
+    string header;
+    vector<std::pair<int, string>> blocks;
+    for (size_t shard = 0; shard < replies.size(); ++shard) {
+        std::istringstream out(replies[shard].out);
+        string line;
+        bool inBlock = false;
+        while (std::getline(out, line)) {
+            if (startsWith(line, planLine)) {
+                blocks.push_back(std::make_pair(std::atoi(line.c_str() + planLine.size()), string()));
+                inBlock = true;
+            }
+            if (inBlock) {
+                blocks.back().second += line + '\n';
+            }
+            else if (shard == 0) {
+                header += line + '\n';
+            }
+        }
+    }
+    std::stable_sort(blocks.begin(), blocks.end(), [](const std::pair<int, string> &a, const std::pair<int, string> &b) {
+        return a.first < b.first;
+    });
+
+    std::cout << header;
+    for (const auto &block : blocks) {
+        std::cout << block.second;
+    }
+    std::cerr << replies[0].err;
+}
+
+//Each shard listed its own best plans; the overall best are among them
+void ShardCoordinator::printTop(const vector<Reply> &replies, size_t count) {
+    const string planLine = "PlanID: ";
+    const string scoreField = ", Score: ";
+    struct Entry {
+        int64_t score;
+        int planId;
+        string line;
+    };
+    vector<Entry> entries;
+    string header;
+    for (size_t shard = 0; shard < replies.size(); ++shard) {
+        std::istringstream out(replies[shard].out);
+        string line;
+        while (std::getline(out, line)) {
+            if (!startsWith(line, planLine)) {
+                if (shard == 0) {
+                    header += line + '\n';
+                }
+                continue;
+            }
+            size_t score = line.rfind(scoreField);
+            entries.push_back(Entry{std::atoll(line.c_str() + score + scoreField.size()),
+                                    std::atoi(line.c_str() + planLine.size()), line});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.score != b.score ? a.score > b.score : a.planId < b.planId;
+    });
+
+    std::cout << header;
+    for (size_t i = 0; i < entries.size() && i < count; ++i) {
+        std::cout << entries[i].line << '\n';
+    }
+    std::cerr << replies[0].err;
+}
+
+//Every shard printed the same "name value" lines. Values counting the shard's own plans are
+//added up; the rest describe the whole world, which every shard ran, and come from shard 0.
+void ShardCoordinator::printSums(const vector<Reply> &replies, bool (*isPerPlan)(const string &name)) {
+    vector<vector<string>> lines(replies.size());
+    for (size_t shard = 0; shard < replies.size(); ++shard) {
+        std::istringstream out(replies[shard].out);
+        string line;
+        while (std::getline(out, line)) {
+            lines[shard].push_back(line);
+        }
+    }
+
+    for (size_t i = 0; i < lines[0].size(); ++i) {
+        const string &line = lines[0][i];
+        size_t space = line.rfind(' ');
+        char *end = nullptr;
+        long long total = space == string::npos ? 0 : std::strtoll(line.c_str() + space + 1, &end, 10);
+        bool summable = end != nullptr && *end == '\0' && end != line.c_str() + space + 1 && isPerPlan(line.substr(0, space));
+        for (size_t shard = 1; summable && shard < lines.size(); ++shard) {
+            if (i >= lines[shard].size()) {
+                summable = false;
+                break;
+            }
+            const string &other = lines[shard][i];
+            total += std::atoll(other.c_str() + other.rfind(' ') + 1);
+        }
+        if (summable) {
+            std::cout << line.substr(0, space + 1) << total << '\n';
+        }
+        else {
+            std::cout << line << '\n';
+        }
+    }
+    std::cerr << replies[0].err;
+}
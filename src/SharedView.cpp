@@ -0,0 +1,173 @@
+#include "SharedView.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char SHARED_VIEW_MAGIC[8] = {'S', 'P', 'L', 'V', 'I', 'E', 'W', '\0'};
+
+//room for this many plans at first; it doubles whenever it runs out
+static const size_t INITIAL_CAPACITY = 1024;
+
+static size_t regionBytes(size_t capacity) {
+    return sizeof(SharedViewHeader) + capacity * sizeof(SharedPlanEntry);
+}
+
+//shm_open names start with a slash
+static string regionName(const string &name) {
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+//Writer constructor - creates the region, or takes over one left by an earlier run
+SharedView::SharedView(const string &name)
+    : name(regionName(name)), fd(-1), header(nullptr), entries(nullptr), capacity(0) {
+    fd = ::shm_open(this->name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Can't open shared view: " + this->name);
+    }
+    try {
+        map(INITIAL_CAPACITY);
+    }
+    catch (...) {
+        ::close(fd);
+        ::shm_unlink(this->name.c_str());
+        throw;
+    }
+    std::memcpy(header->magic, SHARED_VIEW_MAGIC, sizeof(SHARED_VIEW_MAGIC));
+    header->version = SHARED_VIEW_VERSION;
+    header->capacity = static_cast<uint32_t>(capacity);
+    header->sequence.store(0, std::memory_order_relaxed);
+    header->tick = 0;
+    header->planCount = 0;
+    header->reserved = 0;
+}
+
+SharedView::~SharedView() {
+    if (header != nullptr) {
+        ::munmap(header, regionBytes(capacity));
+    }
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+}
+
+//Growing keeps the contents; readers see the new capacity in the header and map again
+void SharedView::map(size_t newCapacity) {
+    if (::ftruncate(fd, regionBytes(newCapacity)) != 0) {
+        throw std::runtime_error("Error: Can't resize shared view: " + name);
+    }
+    void *mapping = ::mmap(nullptr, regionBytes(newCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Error: Can't map shared view: " + name);
+    }
+    if (header != nullptr) {
+        ::munmap(header, regionBytes(capacity));
+    }
+    header = static_cast<SharedViewHeader *>(mapping);
+    entries = reinterpret_cast<SharedPlanEntry *>(header + 1);
+    capacity = newCapacity;
+}
+
+void SharedView::beginWrite() {
+    header->sequence.store(header->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SharedView::endWrite() {
+    header->sequence.store(header->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void SharedView::setTick(int64_t tick) {
+    header->tick = tick;
+}
+
+void SharedView::setPlanCount(size_t count) {
+    if (count > capacity) {
+        size_t grown = capacity;
+        while (grown < count) {
+            grown *= 2;
+        }
+        map(grown);
+        header->capacity = static_cast<uint32_t>(capacity);
+    }
+    header->planCount = static_cast<uint32_t>(count);
+}
+
+void SharedView::setPlan(size_t slot, const Plan &plan) {
+    SharedPlanEntry &entry = entries[slot];
+    entry.planId = plan.getId();
+    entry.status = plan.getStatus() == PlanStatus::BUSY ? 1 : 0;
+    entry.facilities = static_cast<int32_t>(plan.getFacilities().size());
+    entry.underConstruction = static_cast<int32_t>(plan.getUnderConstruction().size());
+    entry.lifeQualityScore = plan.getlifeQualityScore();
+    entry.economyScore = plan.getEconomyScore();
+    entry.environmentScore = plan.getEnvironmentScore();
+    entry.reserved = 0;
+}
+
+//Reader constructor - the header is checked once; a region of another version is refused
+SharedViewReader::SharedViewReader(const string &name) : fd(-1), header(nullptr), capacity(0) {
+    string path = regionName(name);
+    fd = ::shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Can't open shared view: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SharedViewHeader))) {
+        ::close(fd);
+        throw std::runtime_error("Error: Not a shared view: " + path);
+    }
+    map((info.st_size - sizeof(SharedViewHeader)) / sizeof(SharedPlanEntry));
+    if (std::memcmp(header->magic, SHARED_VIEW_MAGIC, sizeof(SHARED_VIEW_MAGIC)) != 0 ||
+        header->version != SHARED_VIEW_VERSION) {
+        ::munmap(const_cast<SharedViewHeader *>(header), regionBytes(capacity));
+        ::close(fd);
+        throw std::runtime_error("Error: Not a shared view: " + path);
+    }
+}
+
+SharedViewReader::~SharedViewReader() {
+    ::munmap(const_cast<SharedViewHeader *>(header), regionBytes(capacity));
+    ::close(fd);
+}
+
+void SharedViewReader::map(size_t newCapacity) {
+    void *mapping = ::mmap(nullptr, regionBytes(newCapacity), PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Error: Can't map shared view");
+    }
+    if (header != nullptr) {
+        ::munmap(const_cast<SharedViewHeader *>(header), regionBytes(capacity));
+    }
+    header = static_cast<const SharedViewHeader *>(mapping);
+    capacity = newCapacity;
+}
+
+bool SharedViewReader::read(int64_t &tick, vector<SharedPlanEntry> &plans, int attempts) {
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        uint64_t before = header->sequence.load(std::memory_order_acquire);
+        if (before % 2 != 0) {
+            sched_yield();
+            continue;
+        }
+        if (header->capacity > capacity) {
+            map(header->capacity);
+            continue;
+        }
+        //a torn count is caught by the sequence check; it only must not run past the mapping
+        size_t count = std::min<size_t>(header->planCount, capacity);
+        tick = header->tick;
+        plans.resize(count);
+        if (count > 0) {
+            std::memcpy(&plans[0], reinterpret_cast<const SharedPlanEntry *>(header + 1), count * sizeof(SharedPlanEntry));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
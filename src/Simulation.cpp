@@ -1,23 +1,60 @@
 #include "Simulation.h"
 #include "Action.h"
 #include "Auxiliary.h"
-#include <fstream>
+#include "Checkpoint.h"
+#include "CommandJournal.h"
+#include "ConfigLoader.h"
+#include "Metrics.h"
+#include "SharedView.h"
+#include "StepEngine.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
+//Converts tokens [first, first+count) of a config line, false if any of them is not a number
+static bool parseInts(const vector<ConfigToken> &tokens, size_t first, size_t count, int *values) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!tokens[first + i].toInt(values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void configError(const ConfigLoader &config, const string &problem) {
+    std::cerr << "Error: config line " << config.getLineNumber() << ": " << problem << ": " << config.getLine() << '\n';
+}
+
 //Constructor
-Simulation::Simulation(const string &configFilePath) :isRunning(false), planCounter(0),
-    actionsLog(), plans(), settlements(), facilitiesOptions(){
-    std::ifstream configFile(configFilePath);
-    if (!configFile.is_open()) {
-        std::cerr << "Error: Can't open config file: " << configFilePath << std::endl;
+Simulation::Simulation(const string &configFilePath, int shard, int shardCount) :isRunning(false), planCounter(0), currentTick(0),
+    symbols(std::make_shared<SymbolTable>()), actionsLog(new ActionLog(symbols)), plans(), settlements(), facilitiesOptions(),
+    settlementIndex(), planIndex(), facilityIndex(), journal(), view(), scheduler(), scheduled(false), leaderboard(), ranked(false), published(false),
+    shard(shard), shardCount(shardCount), diagnostics(nullptr), actionObserver(nullptr){
+    METRIC_TIME(Timer::CONSTRUCT);
+    configureActionsLog();
+    openCommandJournal();
+    openSharedView();
+    ConfigLoader config(configFilePath);
+    if (!config.isOpen()) {
+        std::cerr << "Error: Can't open config file: " << configFilePath << '\n';
         return;
     }
 
-    std::string line;
-    while (std::getline(configFile, line)) {
-        std::vector<std::string> args = Auxiliary::parseArguments(line);
-
+    size_t settlementCount, facilityCount, planCount;
+    config.countRecords(settlementCount, facilityCount, planCount);
+    settlements.write().reserve(settlementCount);
+    settlementIndex.write().reserve(settlementCount);
+    facilitiesOptions.write().reserve(facilityCount);
+    facilityIndex.write().reserve(facilityCount);
+    plans.write().reserve(planCount);
+    planIndex.write().reserve(planCount);
+
+    vector<ConfigToken> args;
+    int values[5];
+    while (config.nextLine(args)) {
         if (args.empty()) {
             continue;
         }
@@ -25,105 +62,102 @@ Simulation::Simulation(const string &configFilePath) :isRunning(false), planCoun
             continue;
         }
         if (args[0] == "settlement") {
-            SettlementType type = static_cast<SettlementType>(std::stoi(args[2]));
-            Settlement *settlement = new Settlement(args[1], type);
-            addSettlement(settlement);
+            if (args.size() < 3 || !parseInts(args, 2, 1, values) || values[0] < 0 || values[0] > 2) {
+                configError(config, "expected settlement <name> <0-2>");
+                continue;
+            }
+            Settlement *settlement = new Settlement(intern(args[1].str()), static_cast<SettlementType>(values[0]));
+            if (!addSettlement(settlement)) {
+                delete settlement;
+            }
         }
         else if (args[0] == "facility") {
-            FacilityCategory category = static_cast<FacilityCategory>(std::stoi(args[2]));
-            FacilityType facility(args[1], category, std::stoi(args[3]), std::stoi(args[4]), std::stoi(args[5]), std::stoi(args[6]));
+            if (args.size() < 7 || !parseInts(args, 2, 5, values) || values[0] < 0 || values[0] > 2) {
+                configError(config, "expected facility <name> <0-2> <price> <lifeq> <eco> <env>");
+                continue;
+            }
+            FacilityCategory category = static_cast<FacilityCategory>(values[0]);
+            FacilityType facility(intern(args[1].str()), category, values[1], values[2], values[3], values[4]);
             addFacility(facility);
         }
         else if (args[0] == "plan") {
-            Settlement &settlement = getSettlement(args[1]);
-            SelectionPolicy *policy = createSelectionPolicy(args[2]);
+            if (args.size() < 3) {
+                configError(config, "expected plan <settlement> <policy>");
+                continue;
+            }
+            string settlementName = args[1].str();
+            if (!isSettlementExists(settlementName)) {
+                configError(config, "unknown settlement " + settlementName);
+                continue;
+            }
+            SelectionPolicy *policy = createSelectionPolicy(args[2].str());
             if (!policy) {
-                std::cerr << "Error creating selection policy for line: " << line << std::endl;
+                configError(config, "could not create selection policy");
                 continue;
             }
-            addPlan(settlement, policy);
+            addPlan(getSettlement(settlementName), policy);
         }
         else {
-            std::cerr << "Warning: Unknown configuration line: " << line << std::endl;
+            std::cerr << "Warning: Unknown configuration line " << config.getLineNumber() << ": " << config.getLine() << '\n';
         }
     }
-
-    configFile.close();
+    publishView();
 }
 
 //Rule Of 5
+//Every member shares its data, so copies and moves are O(1) and nothing is freed by hand.
+//The scheduler and the leaderboard are not carried over; they are rebuilt when next needed.
+//A shard worker's diagnostics sink and action observer stay with the simulation they were set on.
 
 //Delete
-Simulation::~Simulation() {
-
-    for (Settlement *settlement : settlements) {
-        delete settlement;
-    }
-    settlements.clear();
-
-    for (BaseAction *action : actionsLog) {
-        delete action;
-    }
-    actionsLog.clear();
-}
+Simulation::~Simulation() {}
 
 //Copy Constructor
 Simulation::Simulation(const Simulation &other) 
     : isRunning(other.isRunning),
       planCounter(other.planCounter),
-      actionsLog(),
-      plans(),
-      settlements(),
-      facilitiesOptions(other.facilitiesOptions) {
-
-        for (const Settlement *settlement : other.settlements) {
-            settlements.push_back(new Settlement(*settlement));
-        }
-
-        for (const BaseAction *action : other.actionsLog) {
-            actionsLog.push_back(action->clone());
-        }
-
-        for (const Plan &plan : other.plans) {
-            plans.push_back(plan);
-        }
-      }
+      currentTick(other.currentTick),
+      symbols(other.symbols),
+      actionsLog(other.actionsLog),
+      plans(other.plans),
+      settlements(other.settlements),
+      facilitiesOptions(other.facilitiesOptions),
+      settlementIndex(other.settlementIndex),
+      planIndex(other.planIndex),
+      facilityIndex(other.facilityIndex),
+      journal(other.journal),
+      view(other.view),
+      scheduler(),
+      scheduled(false),
+      leaderboard(),
+      ranked(false),
+      published(false),
+      shard(other.shard),
+      shardCount(other.shardCount),
+      diagnostics(nullptr),
+      actionObserver(nullptr) {}
 
 //Copy Assignment operator
 Simulation &Simulation::operator=(const Simulation &other) {
     if (this != &other) {
-        //cleaning existing resources
-        for (Settlement *settlement : settlements) {
-            delete settlement;
-        }
-        settlements.clear();
-
-        for (BaseAction *action : actionsLog) {
-            delete action;
-        }
-        actionsLog.clear();
-
-        plans.clear();
-
-        //copy itself
         isRunning = other.isRunning;
         planCounter = other.planCounter;
-        facilitiesOptions.clear();
-        for (const auto &facility : other.facilitiesOptions) {
-            facilitiesOptions.emplace_back(facility); 
-        }
-
-        for (const Settlement *settlement : other.settlements) {
-            settlements.push_back(new Settlement(*settlement));
-        }
-
-        for (const BaseAction *action : other.actionsLog) {
-            actionsLog.push_back(action->clone());
-        }
-
-        for (const Plan &plan : other.plans) {
-            plans.push_back(plan);
-        }
+        currentTick = other.currentTick;
+        symbols = other.symbols;
+        actionsLog = other.actionsLog;
+        plans = other.plans;
+        settlements = other.settlements;
+        facilitiesOptions = other.facilitiesOptions;
+        settlementIndex = other.settlementIndex;
+        planIndex = other.planIndex;
+        facilityIndex = other.facilityIndex;
+        journal = other.journal;
+        view = other.view;
+        scheduled = false;
+        ranked = false;
+        published = false;
+        shard = other.shard;
+        shardCount = other.shardCount;
     }
     return *this;
 }
@@ -132,10 +166,26 @@ Simulation &Simulation::operator=(const Simulation &other) {
 Simulation::Simulation(Simulation &&other) noexcept
     : isRunning(other.isRunning),
       planCounter(other.planCounter),
+      currentTick(other.currentTick),
+      symbols(std::move(other.symbols)),
       actionsLog(std::move(other.actionsLog)),
       plans(std::move(other.plans)),
       settlements(std::move(other.settlements)),
-      facilitiesOptions(std::move(other.facilitiesOptions)) {
+      facilitiesOptions(std::move(other.facilitiesOptions)),
+      settlementIndex(std::move(other.settlementIndex)),
+      planIndex(std::move(other.planIndex)),
+      facilityIndex(std::move(other.facilityIndex)),
+      journal(std::move(other.journal)),
+      view(std::move(other.view)),
+      scheduler(),
+      scheduled(false),
+      leaderboard(),
+      ranked(false),
+      published(false),
+      shard(other.shard),
+      shardCount(other.shardCount),
+      diagnostics(nullptr),
+      actionObserver(nullptr) {
         other.isRunning = false;
         other.planCounter = 0;
       }
@@ -143,158 +193,225 @@ Simulation::Simulation(Simulation &&other) noexcept
 //Move Assignment operator
 Simulation &Simulation::operator=(Simulation &&other) noexcept {
     if (this != &other) {
-        //cleaning existing resources
-        for (Settlement *settlement : settlements) {
-            delete settlement;
-        }
-        settlements.clear();
-
-        for (BaseAction *action : actionsLog) {
-            delete action;
-        }
-        actionsLog.clear();
-
-        plans.clear();
-
         isRunning = other.isRunning;
         planCounter = other.planCounter;
+        currentTick = other.currentTick;
+        symbols = std::move(other.symbols);
         facilitiesOptions = std::move(other.facilitiesOptions);
         settlements = std::move(other.settlements);
         actionsLog = std::move(other.actionsLog);
         plans = std::move(other.plans);
+        settlementIndex = std::move(other.settlementIndex);
+        planIndex = std::move(other.planIndex);
+        facilityIndex = std::move(other.facilityIndex);
+        journal = std::move(other.journal);
+        view = std::move(other.view);
+        scheduled = false;
+        ranked = false;
+        published = false;
+        shard = other.shard;
+        shardCount = other.shardCount;
 
         other.isRunning = false;
         other.planCounter = 0;
     }
     return *this;
 }
+
 //getter's
 Settlement &Simulation::getSettlement(const std::string &name) {
-    for (auto &settlement : settlements) {
-        if (settlement->getName() == name) {
-            return *settlement;
-        }
+    auto found = settlementIndex->find(symbols->find(name));
+    if (found != settlementIndex->end()) {
+        return *found->second;
     }
     throw std::runtime_error("Settlement" + name + " was not found");
 }
 
+Symbol Simulation::intern(const string &name) {
+    return symbols->intern(name);
+}
 
 
-const std::vector<FacilityType>& Simulation::getFacilitiesOptions() const {
-    return facilitiesOptions;
-}
 
-const std::vector<BaseAction*>& Simulation::getActionsLog() const {
-    return actionsLog;
+const FacilityCatalog& Simulation::getFacilitiesOptions() const {
+    return *facilitiesOptions;
 }
 
-Plan &Simulation::getPlan(const int planId) {
+const ActionLog &Simulation::getActionsLog() const {
+    return *actionsLog;
+}
 
-    for (auto &plan : plans) {
-        if (plan.getId() == planId) {
-            return plan;
+const Leaderboard &Simulation::getLeaderboard() {
+    if (!ranked) {
+        leaderboard.clear();
+        for (size_t slot = 0; slot < plans->size(); ++slot) {
+            leaderboard.update(slot, *(*plans)[slot]);
         }
+        ranked = true;
+    }
+    leaderboard.refresh(*plans);
+    return leaderboard;
+}
+
+//the caller may change the plan, so it is unshared from any backup first
+Plan &Simulation::getPlan(const int planId) {
+    auto found = planIndex->find(planId);
+    if (found != planIndex->end()) {
+        return plans.write()[found->second].write();
     }
 
     throw std::runtime_error("Plan not found");
 }
 
-const std::vector<Plan> &Simulation::getPlans() const {
-    return plans;
+const Plan *Simulation::findPlan(const int planId) const {
+    auto found = planIndex->find(planId);
+    if (found != planIndex->end()) {
+        return &*(*plans)[found->second];
+    }
+    return nullptr;
+}
+
+const std::vector<CowPtr<Plan>> &Simulation::getPlans() const {
+    return *plans;
 }
 
 //methods
-void Simulation::start() {
+void Simulation::start(bool batch) {
     open();
-    std::cout << "The simulation has started" << std::endl;
+    std::cout << "The simulation has started" << '\n';
 
     while (isRunning) {
-        std::cout << "Enter an action: ";
+        if (!batch) {
+            std::cout << "Enter an action: ";
+        }
         std::string inputLine;
-        std::getline(std::cin, inputLine);
-        std::vector<std::string> args = Auxiliary::parseArguments(inputLine);
-
-        if (args.empty()) {
-            std::cerr << "Error: No action provided. " << std::endl;
-            continue;
+        if (!std::getline(std::cin, inputLine)) {
+            break; //end of input
         }
+        runCommand(inputLine);
+    }
+}
 
-        try {
-            if (args[0] == "#") {
-                continue;
-            }
-            if (args[0] == "step") {
-                if (args.size() < 2) {
-                    throw std::runtime_error("Error: Invalid step command format");
-                }
-                int steps = std::stoi(args[1]);
-                SimulateStep stepAction(steps);
-                stepAction.act(*this);
-            }
-            else if (args[0] == "plan") {
-                if (args.size() < 3) {
-                    throw std::runtime_error("Error: Invalid plan command format");
-                }
-                AddPlan addPlanAction(args[1], args[2]);
-                addPlanAction.act(*this);
+void Simulation::runCommand(const string &inputLine) {
+    std::vector<std::string> args = Auxiliary::parseArguments(inputLine);
+
+    if (args.empty()) {
+        std::cerr << "Error: No action provided. " << '\n';
+        return;
+    }
+
+    try {
+        if (args[0] == "#") {
+            return;
+        }
+        if (args[0] == "step") {
+            if (args.size() < 2) {
+                throw std::runtime_error("Error: Invalid step command format");
             }
-            else if (args[0] == "settlement") {
-                if (args.size() < 3) {
-                    throw std::runtime_error("Error: invalid settlement command format");
-                }
-                SettlementType type = static_cast<SettlementType>(std::stoi(args[2]));
-                AddSettlement addSettlementAction(args[1], type);
-                addSettlementAction.act(*this);
+            int steps = std::stoi(args[1]);
+            SimulateStep stepAction(steps);
+            stepAction.act(*this);
+        }
+        else if (args[0] == "plan") {
+            if (args.size() < 3) {
+                throw std::runtime_error("Error: Invalid plan command format");
             }
-            else if (args[0] == "facility") {
-                if (args.size() < 7) {
-                    throw std::runtime_error("Error: invalid facility command format");
-                }
-                FacilityCategory category = static_cast<FacilityCategory>(std::stoi(args[2]));
-                AddFacility addFacilityAction(args[1], category, std::stoi(args[3]), std::stoi(args[4]), std::stoi(args[5]), std::stoi(args[6]));
-                addFacilityAction.act(*this);
+            AddPlan addPlanAction(args[1], args[2]);
+            addPlanAction.act(*this);
+        }
+        else if (args[0] == "settlement") {
+            if (args.size() < 3) {
+                throw std::runtime_error("Error: invalid settlement command format");
             }
-            else if (args[0] == "planStatus") {
-                if (args.size() < 2) {
-                    throw std::runtime_error("Error: invalid planstatus command format");
-                }
-                int planId = std::stoi(args[1]);
-                PrintPlanStatus printPlanStatusAction(planId);
-                printPlanStatusAction.act(*this);
+            SettlementType type = static_cast<SettlementType>(std::stoi(args[2]));
+            AddSettlement addSettlementAction(args[1], type);
+            addSettlementAction.act(*this);
+        }
+        else if (args[0] == "facility") {
+            if (args.size() < 7) {
+                throw std::runtime_error("Error: invalid facility command format");
             }
-            else if (args[0] == "log") {
-                PrintActionsLog printActionsLogAction;
-                printActionsLogAction.act(*this);
+            FacilityCategory category = static_cast<FacilityCategory>(std::stoi(args[2]));
+            AddFacility addFacilityAction(args[1], category, std::stoi(args[3]), std::stoi(args[4]), std::stoi(args[5]), std::stoi(args[6]));
+            addFacilityAction.act(*this);
+        }
+        else if (args[0] == "planStatus") {
+            if (args.size() < 2) {
+                throw std::runtime_error("Error: invalid planstatus command format");
             }
-            else if (args[0] == "changePolicy") {
-                if (args.size() < 3) {
-                    throw std::runtime_error("Error: invalid changepolicy command format");
-                }
-                int planId = std::stoi(args[1]);
-                ChangePlanPolicy changePlanPolicyAction(planId, args[2]);
-                changePlanPolicyAction.act(*this);
+            int planId = std::stoi(args[1]);
+            PrintPlanStatus printPlanStatusAction(planId);
+            printPlanStatusAction.act(*this);
+        }
+        else if (args[0] == "log") {
+            PrintActionsLog printActionsLogAction;
+            printActionsLogAction.act(*this);
+        }
+        else if (args[0] == "top") {
+            if (args.size() < 3) {
+                throw std::runtime_error("Error: invalid top command format");
             }
-            else if (args[0] == "close") {
-                Close closeAction;
-                closeAction.act(*this);
-                close();
+            TopPlans topPlansAction(args[1], std::stoi(args[2]));
+            topPlansAction.act(*this);
+        }
+        else if (args[0] == "world") {
+            PrintWorldScores printWorldScoresAction;
+            printWorldScoresAction.act(*this);
+        }
+        else if (args[0] == "stats") {
+            PrintStats printStatsAction;
+            printStatsAction.act(*this);
+        }
+        else if (args[0] == "changePolicy") {
+            if (args.size() < 3) {
+                throw std::runtime_error("Error: invalid changepolicy command format");
             }
-            else if (args[0] == "backup") {
-                BackupSimulation backupAction;
-                backupAction.act(*this);
+            int planId = std::stoi(args[1]);
+            ChangePlanPolicy changePlanPolicyAction(planId, args[2]);
+            changePlanPolicyAction.act(*this);
+        }
+        else if (args[0] == "close") {
+            Close closeAction;
+            closeAction.act(*this);
+            close();
+        }
+        else if (args[0] == "backup") {
+            BackupSimulation backupAction(args.size() > 1 ? args[1] : "");
+            backupAction.act(*this);
+        }
+        else if (args[0] == "restore") {
+            RestoreSimulation restoreAction(args.size() > 1 ? args[1] : "");
+            restoreAction.act(*this);
+        }
+        else if (args[0] == "save") {
+            if (args.size() < 2) {
+                throw std::runtime_error("Error: invalid save command format");
             }
-            else if (args[0] == "restore") {
-                RestoreSimulation restoreAction;
-                restoreAction.act(*this);
+            SaveSimulation saveAction(args[1]);
+            saveAction.act(*this);
+        }
+        else if (args[0] == "load") {
+            if (args.size() < 2) {
+                throw std::runtime_error("Error: invalid load command format");
             }
-            else {
-                std::cerr << "Error: unknown action '" <<args[0] << "'" <<std::endl;
+            LoadSimulation loadAction(args[1]);
+            loadAction.act(*this);
+        }
+        else if (args[0] == "replay") {
+            if (args.size() < 2) {
+                throw std::runtime_error("Error: invalid replay command format");
             }
+            ReplayJournal replayAction(args[1]);
+            replayAction.act(*this);
         }
-        catch (const std::exception &e) {
-            std::cerr << e.what() << std::endl;
+        else {
+            std::cerr << "Error: unknown action '" <<args[0] << "'" << '\n';
         }
     }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+    publishView(); //a restore or a load may have replaced the plans
 }
 
 void Simulation::close() {
@@ -306,34 +423,147 @@ void Simulation::open() {
 }
 
 void Simulation::step() {
-    for (auto &plan : plans) {
-        plan.step(); //going one step in each plan
+    step(1);
+}
+
+int64_t Simulation::getCurrentTick() const {
+    return currentTick;
+}
+
+//Plans are only stepped on the ticks they have something to do. For long runs, periodic
+//plans are fast-forwarded on their own instead and the rest get a scheduler of their own.
+void Simulation::step(int ticks) {
+    METRIC_TIME(Timer::SIMULATION_STEP);
+    METRIC_ADD(Counter::STEPS, 1);
+    METRIC_ADD(Counter::TICKS, ticks);
+    if (ticks <= 0) {
+        METRIC_ONLY(Metrics::instance().endStep();)
+        return;
+    }
+    const FacilityCatalog &options = *facilitiesOptions;
+    publishView();
+    vector<size_t> periodicSlots;
+
+    if (ticks >= MIN_FAST_FORWARD_TICKS) {
+        vector<Plan*> periodic;
+        ConstructionScheduler others;
+        others.clear(currentTick);
+        vector<CowPtr<Plan>> &all = plans.write();
+        for (size_t slot = 0; slot < all.size(); ++slot) {
+            if (all[slot]->isPeriodic(options)) {
+                periodic.push_back(&all[slot].write());
+                periodicSlots.push_back(slot);
+            }
+            else {
+                others.add(slot, std::max(all[slot]->getNextTick(), currentTick));
+            }
+        }
+        StepEngine::instance().advance(periodic, options, currentTick, ticks);
+        for (size_t i = 0; ranked && i < periodicSlots.size(); ++i) {
+            leaderboard.touch(periodicSlots[i]);
+        }
+        scheduled = false; //the periodic plans moved without it
+        runScheduled(others, ticks);
+    }
+    else {
+        if (!scheduled) {
+            scheduler.clear(currentTick);
+            for (size_t slot = 0; slot < plans->size(); ++slot) {
+                scheduler.add(slot, std::max((*plans)[slot]->getNextTick(), currentTick));
+            }
+            scheduled = true;
+        }
+        runScheduled(scheduler, ticks);
+    }
+
+    //fast-forwarded plans only show up once the whole step is done
+    if (view) {
+        view->beginWrite();
+        for (size_t slot : periodicSlots) {
+            view->setPlan(slot, *(*plans)[slot]);
+        }
+        view->setTick(currentTick);
+        view->endWrite();
+    }
+    METRIC_ONLY(Metrics::instance().endStep();)
+}
+
+//Ticks the plans the scheduler hands out, jumping over ticks where none is due. Only those
+//plans change, so only they stop being shared with backups.
+void Simulation::runScheduled(ConstructionScheduler &due, int ticks) {
+    const FacilityCatalog &options = *facilitiesOptions;
+    StepEngine &engine = StepEngine::instance();
+    int64_t end = currentTick + ticks;
+    vector<size_t> slots;
+    vector<Plan*> stepping;
+
+    for (int64_t tick = due.nextTick(); tick < end; tick = due.nextTick()) {
+        due.takeDue(tick, slots);
+        vector<CowPtr<Plan>> &all = plans.write();
+        stepping.clear();
+        for (size_t slot : slots) {
+            stepping.push_back(&all[slot].write());
+        }
+        if (diagnostics) {
+            stepCollecting(stepping, tick);
+        }
+        else {
+            engine.step(stepping, options, tick); //going one step in each due plan, across all cores
+        }
+        for (size_t i = 0; i < slots.size(); ++i) {
+            due.add(slots[i], stepping[i]->getNextTick());
+            if (ranked) {
+                leaderboard.touch(slots[i]);
+            }
+        }
+        if (view) {
+            view->beginWrite();
+            for (size_t i = 0; i < slots.size(); ++i) {
+                view->setPlan(slots[i], *stepping[i]);
+            }
+            view->setTick(tick + 1);
+            view->endWrite();
+        }
+    }
+    currentTick = end;
+}
+
+//A shard worker steps its due plans itself, one at a time, so each plan's diagnostics can be
+//kept with its id; the shards running side by side take the place of the step threads.
+void Simulation::stepCollecting(const vector<Plan*> &stepping, int64_t tick) {
+    METRIC_TIME(Timer::PLAN_STEPS);
+    METRIC_ADD(Counter::PLAN_STEPS, stepping.size());
+    std::ostringstream log;
+    for (Plan *plan : stepping) {
+        plan->step(*facilitiesOptions, tick, log);
+        if (log.tellp() > 0) {
+            diagnostics->push_back(PlanDiagnostic{tick, plan->getId(), log.str()});
+            log.str("");
+        }
     }
 }
 
 bool Simulation::addSettlement(Settlement *settlement) {
     if (!settlement){
-        std::cout << "Error: nullPtr" << std::endl;
+        std::cout << "Error: nullPtr" << '\n';
         return false;
     }
-    for (const auto &s : settlements) {
-        if (s->getName() == settlement->getName()) {
-            std::cout << "Error: Settlement already exists" << std::endl;
-            return false; //duplicate
-        }
+    if (isSettlementExists(settlement->getName())) {
+        std::cout << "Error: Settlement already exists" << '\n';
+        return false; //duplicate
     }
-    settlements.push_back(settlement);
+    settlements.write().push_back(std::shared_ptr<Settlement>(settlement, std::default_delete<Settlement>(), PoolAllocator<Settlement>()));
+    settlementIndex.write()[settlement->getSymbol()] = settlement;
     return true; //added succesfuly
 }
 
 bool Simulation::addFacility(FacilityType facility) {
-    for (const FacilityType &f : facilitiesOptions) {
-        if (f.getName() == facility.getName()) {
-            std::cout << "Facility already exists" << std::endl;
-            return false; //duplicate
-        }
+    if (isFacilityExists(facility.getName())) {
+        std::cout << "Facility already exists" << '\n';
+        return false; //duplicate
     }
-    facilitiesOptions.emplace_back(facility);
+    facilityIndex.write()[facility.getSymbol()] = facilitiesOptions->size();
+    facilitiesOptions.write().add(facility);
     return true; //added succesfuly
 }
 
@@ -342,19 +572,108 @@ void Simulation::addPlan(const Settlement &settlement, SelectionPolicy *selectio
         throw std::runtime_error("Error: selection policy is null");
     }
 
-    Plan newPlan(planCounter++, settlement, selectionPolicy, facilitiesOptions);
-
-    plans.push_back(newPlan);
+    int planId = planCounter++;
+    //another shard holds this plan; the id is still used up so every shard numbers plans alike
+    if (!ownsSettlement(settlement.getName())) {
+        std::cout <<"Plan created for settlement: " << settlement.getName()
+                  <<" with policy: " << selectionPolicy->toString() << '\n';
+        delete selectionPolicy;
+        return;
+    }
+    planIndex.write()[planId] = plans->size();
+    plans.write().push_back(CowPtr<Plan>(new Plan(planId, settlement, selectionPolicy)));
+    if (scheduled) {
+        scheduler.add(plans->size() - 1, currentTick);
+    }
+    if (ranked) {
+        leaderboard.update(plans->size() - 1, *plans->back());
+    }
+    if (view && published) {
+        view->beginWrite();
+        view->setPlanCount(plans->size());
+        view->setPlan(plans->size() - 1, *plans->back());
+        view->endWrite();
+    }
 
     std::cout <<"Plan created for settlement: " << settlement.getName()
-              <<" with policy: " << selectionPolicy->toString() << std::endl;
+              <<" with policy: " << selectionPolicy->toString() << '\n';
 }
 
 void Simulation::addAction(BaseAction *action) {
     if (!action) {
         throw std::runtime_error("Error: Invalid action");
     }
-    actionsLog.push_back(action->clone());
+    actionsLog.write().append(*action);
+    if (journal) {
+        journal->record(*action);
+    }
+    if (actionObserver) {
+        action->save(*actionObserver);
+    }
+}
+
+//SIM_LOG_LIMIT bounds the records kept in memory, SIM_LOG_JOURNAL names a file for the older ones
+void Simulation::configureActionsLog() {
+    const char *limit = std::getenv("SIM_LOG_LIMIT");
+    const char *journal = std::getenv("SIM_LOG_JOURNAL");
+    if (!limit && !journal) {
+        return;
+    }
+    long records = limit ? std::atol(limit) : 0;
+    try {
+        actionsLog.write().configure(records > 0 ? records : 0, journal ? journal : "");
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+//SIM_COMMAND_JOURNAL names a file that every completed state-changing action is appended to
+void Simulation::openCommandJournal() {
+    const char *path = std::getenv("SIM_COMMAND_JOURNAL");
+    if (!path || !*path) {
+        return;
+    }
+    try {
+        journal = std::make_shared<CommandJournal>(path);
+        if (journal->getCutBytes() > 0) {
+            std::cerr << "Error: Command journal ended in a damaged record; cut off its last "
+                      << journal->getCutBytes() << " bytes" << '\n';
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+//SIM_SHARED_VIEW names a shared memory region the plans are published to (see SharedView.h)
+void Simulation::openSharedView() {
+    const char *name = std::getenv("SIM_SHARED_VIEW");
+    if (!name || !*name) {
+        return;
+    }
+    try {
+        view = std::make_shared<SharedView>(name);
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+//Writes every plan to the shared view, unless it already holds them all as they are.
+//After that, only the plans a tick steps are written again.
+void Simulation::publishView() {
+    if (!view || published) {
+        return;
+    }
+    view->beginWrite();
+    view->setPlanCount(plans->size());
+    for (size_t slot = 0; slot < plans->size(); ++slot) {
+        view->setPlan(slot, *(*plans)[slot]);
+    }
+    view->setTick(currentTick);
+    view->endWrite();
+    published = true;
 }
 
 SelectionPolicy *Simulation::createSelectionPolicy(const string &policyType){
@@ -371,28 +690,197 @@ SelectionPolicy *Simulation::createSelectionPolicy(const string &policyType){
         return new SustainabilitySelection();
     }
     else {
-        std::cerr << "Error: Unknown selection policy type: " << policyType << std::endl;
+        std::cerr << "Error: Unknown selection policy type: " << policyType << '\n';
         return nullptr;
     }
 }
 
+//a name that was never interned can't be in either index
 bool Simulation::isSettlementExists(const std::string &name) {
-    for (const auto &settlemt : settlements) {
-        if (settlemt->getName() == name) {
-            return true;
-        }
+    return settlementIndex->count(symbols->find(name)) != 0;
+}
+
+bool Simulation::isFacilityExists(const std::string &name) const {
+    return facilityIndex->count(symbols->find(name)) != 0;
+}
+
+//FNV-1a of the name, so every shard process agrees on the owner
+bool Simulation::ownsSettlement(const string &settlementName) const {
+    if (shardCount <= 1) {
+        return true;
     }
-    return false;
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : settlementName) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return static_cast<int>(hash % static_cast<uint32_t>(shardCount)) == shard;
+}
+
+void Simulation::collectDiagnostics(vector<PlanDiagnostic> *sink) {
+    diagnostics = sink;
+}
+
+void Simulation::setActionObserver(ValueWriter *observer) {
+    actionObserver = observer;
 }
 
 void Simulation::clearPlans() {
-    plans.clear();
+    plans.write().clear();
+    planIndex.write().clear();
+    scheduled = false;
+    ranked = false;
+    published = false;
 }
 
 void Simulation::clearSettlements() {
-    for (auto* settlement : settlements) {
-        delete settlement;
+    settlements.write().clear();
+    settlementIndex.write().clear();
+}
+
+
+//Checkpoint - writes the whole world: settlements, facility options, plans with their
+//policy and construction state, and the actions log. Snapshots are not included.
+void Simulation::saveCheckpoint(const string &path) const {
+    CheckpointWriter writer;
+    writer.writeInt(planCounter);
+
+    writer.writeInt(static_cast<int>(settlements->size()));
+    for (const auto &settlement : *settlements) {
+        writer.writeString(settlement->getName());
+        writer.writeInt(static_cast<int>(settlement->getType()));
+    }
+
+    writer.writeInt(static_cast<int>(facilitiesOptions->size()));
+    for (const FacilityType &facility : facilitiesOptions->getFacilities()) {
+        facility.save(writer);
+    }
+
+    writer.writeInt(static_cast<int>(plans->size()));
+    for (const auto &plan : *plans) {
+        writer.writeString(plan->getSettlement().getName());
+        plan->save(writer, currentTick);
     }
-    settlements.clear();
+
+    actionsLog->save(writer);
+
+    writer.saveTo(path);
 }
 
+//Replaces the current state with the checkpoint's. The state is only swapped in once the
+//whole file has been read, so a bad file leaves the simulation untouched.
+void Simulation::loadCheckpoint(const string &path) {
+    CheckpointReader reader(path);
+    int newPlanCounter = reader.readInt();
+
+    vector<std::shared_ptr<Settlement>> newSettlements;
+    std::unordered_map<Symbol, Settlement*, SymbolHash> newSettlementIndex;
+    int count = reader.readInt();
+    for (int i = 0; i < count; ++i) {
+        Symbol name = intern(reader.readString());
+        int type = reader.readInt(); //any number the settlement command took; unknown types build nothing
+        if (newSettlementIndex.count(name) != 0) {
+            throw std::runtime_error("Error: Checkpoint file is corrupt");
+        }
+        newSettlements.push_back(std::allocate_shared<Settlement>(PoolAllocator<Settlement>(), name, static_cast<SettlementType>(type)));
+        newSettlementIndex[name] = newSettlements.back().get();
+    }
+
+    FacilityCatalog newFacilities;
+    std::unordered_map<Symbol, size_t, SymbolHash> newFacilityIndex;
+    count = reader.readInt();
+    for (int i = 0; i < count; ++i) {
+        newFacilities.add(FacilityType::load(reader, *symbols));
+        newFacilityIndex[newFacilities[i].getSymbol()] = newFacilities.size() - 1;
+    }
+
+    vector<CowPtr<Plan>> newPlans;
+    std::unordered_map<int, size_t> newPlanIndex;
+    count = reader.readInt();
+    for (int i = 0; i < count; ++i) {
+        auto settlement = newSettlementIndex.find(symbols->find(reader.readString()));
+        if (settlement == newSettlementIndex.end()) {
+            throw std::runtime_error("Error: Checkpoint file is corrupt");
+        }
+        newPlans.push_back(CowPtr<Plan>(Plan::load(reader, *settlement->second, newFacilities, currentTick)));
+        newPlanIndex[newPlans.back()->getId()] = newPlans.size() - 1;
+    }
+
+    ActionLog newActionsLog = actionsLog->cleared();
+    newActionsLog.load(reader);
+
+    if (!reader.atEnd()) {
+        throw std::runtime_error("Error: Checkpoint file is corrupt");
+    }
+
+    planCounter = newPlanCounter;
+    settlements = CowPtr<vector<std::shared_ptr<Settlement>>>(new vector<std::shared_ptr<Settlement>>(std::move(newSettlements)));
+    settlementIndex = CowPtr<std::unordered_map<Symbol, Settlement*, SymbolHash>>(new std::unordered_map<Symbol, Settlement*, SymbolHash>(std::move(newSettlementIndex)));
+    facilitiesOptions = CowPtr<FacilityCatalog>(new FacilityCatalog(std::move(newFacilities)));
+    facilityIndex = CowPtr<std::unordered_map<Symbol, size_t, SymbolHash>>(new std::unordered_map<Symbol, size_t, SymbolHash>(std::move(newFacilityIndex)));
+    plans = CowPtr<vector<CowPtr<Plan>>>(new vector<CowPtr<Plan>>(std::move(newPlans)));
+    planIndex = CowPtr<std::unordered_map<int, size_t>>(new std::unordered_map<int, size_t>(std::move(newPlanIndex)));
+    actionsLog = CowPtr<ActionLog>(new ActionLog(std::move(newActionsLog)));
+    scheduled = false;
+    ranked = false;
+    published = false;
+}
+
+//Applies a command journal on top of the current state. Runs of steps are applied as one
+//step of their total length, which lets periodic plans fast-forward over the whole run.
+//Replay stops at the first damaged record and says which one it was.
+void Simulation::replay(const string &journalPath) {
+    JournalReader reader(journalPath);
+    std::shared_ptr<CommandJournal> target = journal;
+    bool intoItself = target && target->isSameFile(journalPath);
+    if (intoItself) {
+        target->setSuspended(true);
+    }
+
+    int pendingTicks = 0;
+    int replayed = 0;
+    try {
+        while (!reader.atEnd()) {
+            size_t offset = reader.getOffset();
+            std::unique_ptr<BaseAction> action;
+            try {
+                reader.beginRecord();
+                action.reset(BaseAction::load(reader));
+                reader.endRecord();
+            }
+            catch (const std::exception &e) {
+                std::cerr << e.what() << '\n';
+                std::cerr << "Error: Replay stopped at record " << replayed + 1 << " (byte " << offset
+                          << ") of the command journal, after replaying " << replayed << " records" << '\n';
+                break;
+            }
+            replayed++;
+
+            if (action->getType() == ActionType::SIMULATE_STEP) {
+                int ticks = static_cast<const SimulateStep &>(*action).getNumOfSteps();
+                if (pendingTicks > INT_MAX - ticks) {
+                    SimulateStep(pendingTicks).act(*this);
+                    pendingTicks = 0;
+                }
+                pendingTicks += ticks;
+                continue;
+            }
+            if (pendingTicks > 0) {
+                SimulateStep(pendingTicks).act(*this);
+                pendingTicks = 0;
+            }
+            action->act(*this);
+        }
+        if (pendingTicks > 0) {
+            SimulateStep(pendingTicks).act(*this);
+        }
+    }
+    catch (...) {
+        if (intoItself) {
+            target->setSuspended(false);
+        }
+        throw;
+    }
+    if (intoItself) {
+        target->setSuspended(false);
+    }
+}
@@ -0,0 +1,187 @@
+#include "StepEngine.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+//Below this many plans per chunk, waking a worker costs more than it saves
+static const size_t MIN_PLANS_PER_CHUNK = 256;
+
+//SIM_THREADS overrides the detected core count (1 forces the serial path)
+static unsigned detectThreadCount() {
+    const char *env = std::getenv("SIM_THREADS");
+    if (env != nullptr && std::atoi(env) > 0) {
+        return static_cast<unsigned>(std::atoi(env));
+    }
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
+
+//SIM_BATCH_STEPS=0 steps every plan on its own instead of in groups
+static bool detectBatching() {
+    const char *env = std::getenv("SIM_BATCH_STEPS");
+    return env == nullptr || std::atoi(env) != 0;
+}
+
+StepEngine &StepEngine::instance() {
+    static StepEngine engine(detectThreadCount());
+    return engine;
+}
+
+//Constructor - the calling thread always steps chunk 0, so only threadCount-1 workers are spawned
+StepEngine::StepEngine(unsigned threadCount)
+    : workers(), chunkLogs(threadCount), batches(threadCount), batching(detectBatching()), mutex(), wake(), done(),
+      plans(nullptr), facilityOptions(nullptr), tick(0), ticks(0), chunkCount(0), pending(0), generation(0), stopping(false) {
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers.push_back(std::thread(&StepEngine::workerLoop, this, i));
+    }
+}
+
+StepEngine::~StepEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned StepEngine::getThreadCount() const {
+    return static_cast<unsigned>(workers.size() + 1);
+}
+
+void StepEngine::stepChunk(size_t chunk, std::ostream &log) {
+    size_t total = plans->size();
+    size_t begin = chunk * total / chunkCount;
+    size_t end = (chunk + 1) * total / chunkCount;
+    METRIC_TIME(Timer::PLAN_STEPS); //summed over threads, so it can exceed the step's wall time
+    METRIC_ADD(Counter::PLAN_STEPS, (end - begin) * (ticks == 0 ? 1 : ticks));
+    if (ticks == 0 && batching && !facilityOptions->empty()) {
+        stepBatched(chunk, begin, end, log);
+        return;
+    }
+    for (size_t i = begin; i < end; ++i) {
+        if (ticks == 0) {
+            (*plans)[i]->step(*facilityOptions, tick, log);
+        }
+        else {
+            (*plans)[i]->advance(*facilityOptions, tick, ticks, log);
+        }
+    }
+}
+
+//A plan only prints when its policy has nothing to pick from, which depends on the policy
+//kind and the catalog alone. Plans of the other kinds are stepped a group at a time, each
+//group with one policy class and one construction limit, and print nothing; the rest are
+//stepped in plan order so their diagnostics keep it.
+void StepEngine::stepBatched(size_t chunk, size_t begin, size_t end, std::ostream &log) {
+    Batch &batch = batches[chunk];
+    int selectable[POLICY_KINDS] = {-1, -1, -1, -1}; //unknown until a plan of that kind is seen
+
+    for (size_t i = begin; i < end; ++i) {
+        Plan *plan = (*plans)[i];
+        const SelectionPolicy &policy = plan->getSelectionPolicy();
+        size_t kind = static_cast<size_t>(policy.getKind());
+        if (selectable[kind] < 0) {
+            selectable[kind] = policy.canSelect(*facilityOptions) ? 1 : 0;
+        }
+        //the settlement command takes any type number; those outside the known ones build nothing
+        size_t type = static_cast<size_t>(plan->getSettlement().getType());
+        if (selectable[kind] == 0 || type >= SETTLEMENT_TYPES) {
+            batch.ordered.push_back(plan);
+            continue;
+        }
+        batch.groups[kind * SETTLEMENT_TYPES + type].push_back(plan);
+    }
+
+    for (size_t group = 0; group < POLICY_KINDS * SETTLEMENT_TYPES; ++group) {
+        vector<Plan*> &members = batch.groups[group];
+        Plan::stepGroup(members.data(), members.size(), static_cast<PolicyKind>(group / SETTLEMENT_TYPES),
+                        *facilityOptions, tick, log);
+        members.clear();
+    }
+    for (Plan *plan : batch.ordered) {
+        plan->step(*facilityOptions, tick, log);
+    }
+    batch.ordered.clear();
+}
+
+void StepEngine::workerLoop(size_t worker) {
+    unsigned long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        if (worker >= chunkCount) {
+            continue; //not needed for this tick
+        }
+
+        lock.unlock();
+        std::ostringstream log;
+        stepChunk(worker, log);
+        lock.lock();
+
+        chunkLogs[worker] = log.str();
+        if (--pending == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+//One tick for every plan
+void StepEngine::step(vector<Plan*> &plans, const FacilityCatalog &facilityOptions, int64_t tick) {
+    run(plans, facilityOptions, tick, 0);
+}
+
+//Moves every plan forward by the given ticks. Plans are independent, so there is
+//no barrier between the ticks; only use this for plans that print no diagnostics.
+void StepEngine::advance(vector<Plan*> &plans, const FacilityCatalog &facilityOptions, int64_t tick, int ticks) {
+    run(plans, facilityOptions, tick, ticks);
+}
+
+void StepEngine::run(vector<Plan*> &plans, const FacilityCatalog &facilityOptions, int64_t tick, int ticks) {
+    if (plans.empty()) {
+        return;
+    }
+    size_t chunks = std::min<size_t>(workers.size() + 1, plans.size() / MIN_PLANS_PER_CHUNK);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->plans = &plans;
+        this->facilityOptions = &facilityOptions;
+        this->tick = tick;
+        this->ticks = ticks;
+        chunkCount = std::max<size_t>(chunks, 1);
+    }
+
+    //small worlds are not worth the hand-off
+    if (chunks <= 1) {
+        stepChunk(0, std::cerr);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = chunks - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    //chunk 0 holds the lowest plan ids, so its diagnostics can go straight out
+    stepChunk(0, std::cerr);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+        std::cerr << chunkLogs[chunk];
+        chunkLogs[chunk].clear();
+    }
+    this->plans = nullptr;
+    this->facilityOptions = nullptr;
+}
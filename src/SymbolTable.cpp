@@ -0,0 +1,16 @@
+#include "SymbolTable.h"
+
+SymbolTable::SymbolTable() : names() {}
+
+Symbol SymbolTable::intern(const string &name) {
+    return Symbol(&*names.insert(name).first);
+}
+
+Symbol SymbolTable::find(const string &name) const {
+    auto found = names.find(name);
+    return found != names.end() ? Symbol(&*found) : Symbol();
+}
+
+size_t SymbolTable::size() const {
+    return names.size();
+}
@@ -1,24 +1,127 @@
 #include "Simulation.h"
+#include "BatchIO.h"
+#include "Metrics.h"
+#include "Shard.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <unistd.h>
 
 using namespace std;
 
-Simulation *backup = nullptr;
+std::unordered_map<string, Simulation*> backups;
+
+#ifndef SIM_NO_METRICS
+//every allocation is counted for the allocations metric
+void *operator new(size_t size)
+{
+    Metrics::countAllocation();
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+//batch mode reads and writes in blocks of this size
+static const size_t BATCH_BUFFER_SIZE = 1 << 20;
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    //--batch / --interactive override the default, which is batch when stdin is not a terminal
+    bool batch = !isatty(STDIN_FILENO);
+    int shards = 1;
+    const char *configPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--batch") == 0)
+        {
+            batch = true;
+        }
+        else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            shards = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--interactive") == 0)
+        {
+            batch = false;
+        }
+        else if (configPath == nullptr)
+        {
+            configPath = argv[i];
+        }
+        else
+        {
+            configPath = nullptr;
+            break;
+        }
+    }
+    if (configPath == nullptr)
     {
-        cout << "usage: simulation <config_path>" << endl;
+        cout << "usage: simulation [--batch | --interactive] [--shards N] <config_path>" << '\n';
         return 0;
     }
-    string configurationFile = argv[1];
-    Simulation simulation(configurationFile);
-    simulation.start();
-    if (backup != nullptr)
+
+    BlockInputBuffer input(STDIN_FILENO, BATCH_BUFFER_SIZE);
+    BlockOutputBuffer output(STDOUT_FILENO, BATCH_BUFFER_SIZE);
+    streambuf *standardInput = cin.rdbuf();
+    streambuf *standardOutput = cout.rdbuf();
+    if (batch)
+    {
+        cout.flush();
+        cin.rdbuf(&input);
+        cout.rdbuf(&output);
+        cin.tie(nullptr); //reading a command no longer flushes the output
+    }
+
+    if (shards > 1)
+    {
+        //the plans live in shard processes; this one only reads commands and merges output
+        try
+        {
+            ShardCoordinator coordinator(configPath, shards);
+            coordinator.start(batch);
+        }
+        catch (const exception &e)
+        {
+            cerr << e.what() << '\n';
+        }
+    }
+    else
+    {
+        string configurationFile = configPath;
+        Simulation simulation(configurationFile);
+        simulation.start(batch);
+    }
+    for (auto &snapshot : backups)
+    {
+        delete snapshot.second;
+    }
+    backups.clear();
+
+    if (batch)
     {
-        delete backup;
-        backup = nullptr;
+        cout.flush();
+        cin.rdbuf(standardInput);
+        cout.rdbuf(standardOutput);
     }
     return 0;
-}
\ No newline at end of file
+}